@@ -27,6 +27,7 @@
 */
 #include "flash_mem.h"
 #include "defines.h"
+#include "utils.h"
 #include "usb.h"
 #include <avr/io.h>
 #include <stdint.h>
@@ -35,6 +36,9 @@
     #error "SPI not implemented"
 #endif
 
+// Buffer being written to its page by a program that was started without waiting for it
+static uint8_t flash_programming_buffer = FLASH_NO_BUFFER;
+
 
 /*! \fn     memoryBoundaryErrorCallback(void)
 *   \brief  Function called when a memory boundary issue occurs
@@ -64,35 +68,50 @@ static inline void fillPageReadWriteEraseOpcodeFromAddress(uint16_t pageNumber,
 }
 
 
-/*! \fn     sendDataToFlashWithFourBytesOpcode(uint8_t* opcode, uint8_t* buffer, uint16_t buffer_size)
-*   \brief  Send data with a four bytes opcode to flash
+/*! \fn     sendFlashCommand(uint8_t* opcode, uint8_t* buffer, uint16_t buffer_size)
+*   \brief  Send data with a four bytes opcode to flash, without checking if it is busy
 *   \param  opcode      Pointer to 4 bytes long opcode
 *   \param  buffer      Pointer to the buffer of data
 *   \param  buffer_size Length of the buffer
 */
-void sendDataToFlashWithFourBytesOpcode(uint8_t* opcode, uint8_t* buffer, uint16_t buffer_size)
+static void sendFlashCommand(uint8_t* opcode, uint8_t* buffer, uint16_t buffer_size)
 {
     /* Assert chip select */
     PORT_FLASH_nS &= ~(1 << PORTID_FLASH_nS);
 
     // Send opcode
-    for (uint8_t i = 0; i < 4; i++)
-    {
-        *opcode = spiUsartTransfer(*opcode);
-        opcode++;
-    }
+    spiUsartReadWrite(opcode, 4);
     
     // Retrieve data
-    while (buffer_size--)
-    {
-        *buffer = spiUsartTransfer(*buffer);
-        buffer++;
-    }    
+    spiUsartReadWrite(buffer, buffer_size);
     
     /* Deassert chip select */
     PORT_FLASH_nS |= (1 << PORTID_FLASH_nS);
 }
 
+/*! \fn     flashWaitPendingProgram(void)
+*   \brief  Let a page program started by flashStartBufferToPage finish before accessing the flash array
+*/
+static void flashWaitPendingProgram(void)
+{
+    if (flash_programming_buffer != FLASH_NO_BUFFER)
+    {
+        waitForFlash();
+    }
+}
+
+/*! \fn     sendDataToFlashWithFourBytesOpcode(uint8_t* opcode, uint8_t* buffer, uint16_t buffer_size)
+*   \brief  Send data with a four bytes opcode to flash
+*   \param  opcode      Pointer to 4 bytes long opcode
+*   \param  buffer      Pointer to the buffer of data
+*   \param  buffer_size Length of the buffer
+*/
+void sendDataToFlashWithFourBytesOpcode(uint8_t* opcode, uint8_t* buffer, uint16_t buffer_size)
+{
+    flashWaitPendingProgram();
+    sendFlashCommand(opcode, buffer, buffer_size);
+}
+
 /**
  * Waits for the flash to be ready (polls the flash chip status register)
  * @return  success status
@@ -114,6 +133,7 @@ void waitForFlash(void)
     
     /* Deassert chip select */
     PORT_FLASH_nS |= (1 << PORTID_FLASH_nS);
+    flash_programming_buffer = FLASH_NO_BUFFER;
 } // End waitForFlash
 
 /**
@@ -402,6 +422,54 @@ void flashRawRead(uint8_t* datap, uint16_t addr, uint16_t size)
     sendDataToFlashWithFourBytesOpcode(op, datap, size);
 }
 
+/**
+ * Open a continuous read session, chip select stays asserted until flashReadStreamClose
+ * @param   addr            byte offset in the flash, with the same 65k addressing space as flashRawRead
+ * @note    nothing else may use the SPI bus while the session is open
+ */
+void flashReadStreamOpen(uint16_t addr)
+{
+    uint16_t page_number = (addr/BYTES_PER_PAGE);
+    uint8_t high_byte = page_number >> (16 - READ_OFFSET_SHT_AMT);
+    addr = (page_number << READ_OFFSET_SHT_AMT) | (addr % BYTES_PER_PAGE);
+    uint8_t op[] = {FLASH_OPCODE_LOWF_READ, high_byte, (uint8_t)(addr >> 8), (uint8_t)addr};
+    
+    flashWaitPendingProgram();
+    
+    /* Assert chip select */
+    PORT_FLASH_nS &= ~(1 << PORTID_FLASH_nS);
+    
+    spiUsartWrite(op, sizeof(op));
+}
+
+/**
+ * Get the next byte of an open read session
+ * @return  the byte
+ */
+uint8_t flashReadStreamGetByte(void)
+{
+    return spiUsartTransfer(0);
+}
+
+/**
+ * Get the next bytes of an open read session, the continuous read wraps to the next page by itself
+ * @param   datap           pointer to the buffer to store the read data
+ * @param   size            the number of bytes to read
+ */
+void flashReadStream(uint8_t* datap, uint16_t size)
+{
+    spiUsartRead(datap, size);
+}
+
+/**
+ * Close a read session
+ */
+void flashReadStreamClose(void)
+{
+    /* Deassert chip select */
+    PORT_FLASH_nS |= (1 << PORTID_FLASH_nS);
+}
+
 /**
  * Write data into the internal memory buffer
  * @param datap pointer to data to write
@@ -432,4 +500,93 @@ void flashWriteBufferToPage(uint16_t page)
     fillPageReadWriteEraseOpcodeFromAddress(page, 0, &op[1]);
     sendDataToFlashWithFourBytesOpcode(op, op, 0);
     waitForFlash();
-}
\ No newline at end of file
+}
+
+/**
+ * Write data into one of the internal memory buffers, while the other one may be programmed
+ * @param buffer_id FLASH_BUFFER_1 or FLASH_BUFFER_2, ignored by single buffer chips
+ * @param datap pointer to data to write
+ * @param offset offset to start writing to in the internal memory buffer
+ * @param size the number of bytes to write
+ * @note only waits for the flash if the buffer is being programmed
+ */
+void flashWriteBufferNoWait(uint8_t buffer_id, uint8_t* datap, uint16_t offset, uint16_t size)
+{
+    uint8_t op[4];
+    
+    #if FLASH_NB_BUFFERS == 1
+        buffer_id = FLASH_BUFFER_1;
+    #endif
+    if (buffer_id == flash_programming_buffer)
+    {
+        waitForFlash();
+    }
+    op[0] = (buffer_id == FLASH_BUFFER_2) ? FLASH_OPCODE_BUF2_WRITE : FLASH_OPCODE_BUF_WRITE;
+    fillPageReadWriteEraseOpcodeFromAddress(0, offset, &op[1]);
+    sendFlashCommand(op, datap, size);
+}
+
+/**
+ * Start writing the contents of an internal memory buffer to a page in flash, without waiting
+ * @param   buffer_id FLASH_BUFFER_1 or FLASH_BUFFER_2, ignored by single buffer chips
+ * @param   page the page to store the buffer in
+ * @note    the next flash access other than a write to the other buffer waits for completion
+ */
+void flashStartBufferToPage(uint8_t buffer_id, uint16_t page)
+{
+    uint8_t op[4];
+    
+    #if FLASH_NB_BUFFERS == 1
+        buffer_id = FLASH_BUFFER_1;
+    #endif
+    op[0] = (buffer_id == FLASH_BUFFER_2) ? FLASH_OPCODE_BUF2_TO_PAGE : FLASH_OPCODE_BUF_TO_PAGE;
+    fillPageReadWriteEraseOpcodeFromAddress(page, 0, &op[1]);
+    sendDataToFlashWithFourBytesOpcode(op, op, 0);
+    flash_programming_buffer = buffer_id;
+}
+
+/**
+ * Compute the CRC32 of a page range with a single continuous array read
+ * @param   start_page  The first page
+ * @param   nb_pages    The number of pages
+ * @param   crc         The CRC32 of the data preceding the range, 0 for none
+ * @return  The CRC32 (IEEE 802.3, same as zlib)
+ * @note    The data is never buffered, each byte is added to the CRC as it is clocked out
+ * @note    Large ranges are split by the caller, chaining the returned CRCs
+ */
+uint32_t flashCrc32(uint16_t start_page, uint16_t nb_pages, uint32_t crc)
+{
+    uint32_t nb_bytes = (uint32_t)nb_pages * BYTES_PER_PAGE;
+    
+    crc = ~crc;
+    uint8_t op[4];
+    
+    #ifdef MEMORY_BOUNDARY_CHECKS
+        // Error check the page range
+        if (((uint32_t)start_page + nb_pages) > PAGE_COUNT)
+        {
+            memoryBoundaryErrorCallback();
+        }
+    #endif
+    
+    flashWaitPendingProgram();
+    
+    op[0] = FLASH_OPCODE_LOWF_READ;
+    fillPageReadWriteEraseOpcodeFromAddress(start_page, 0, &op[1]);
+    
+    /* Assert chip select */
+    PORT_FLASH_nS &= ~(1 << PORTID_FLASH_nS);
+    
+    spiUsartWrite(op, sizeof(op));
+    
+    // The continuous read wraps to the next page by itself
+    while (nb_bytes--)
+    {
+        crc = crc32Update(crc, spiUsartTransfer(0));
+    }
+    
+    /* Deassert chip select */
+    PORT_FLASH_nS |= (1 << PORTID_FLASH_nS);
+    
+    return ~crc;
+}
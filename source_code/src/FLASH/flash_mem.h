@@ -39,13 +39,21 @@ void blockErase(uint16_t blockNumber);
 void pageErase(uint16_t pageNumber);
 
 void chipErase(void);
+void waitForFlash(void);
 void formatFlash(void);
 void initFlashIOs(void);
 RET_TYPE checkFlashID(void);
 void flashWriteBufferToPage(uint16_t page);
 void loadPageToInternalBuffer(uint16_t page_number);
 void flashRawRead(uint8_t* datap, uint16_t addr, uint16_t size);
+void flashReadStreamOpen(uint16_t addr);
+uint8_t flashReadStreamGetByte(void);
+void flashReadStream(uint8_t* datap, uint16_t size);
+void flashReadStreamClose(void);
 void flashWriteBuffer(uint8_t* datap, uint16_t offset, uint16_t size);
+void flashStartBufferToPage(uint8_t buffer_id, uint16_t page);
+uint32_t flashCrc32(uint16_t start_page, uint16_t nb_pages, uint32_t crc);
+void flashWriteBufferNoWait(uint8_t buffer_id, uint8_t* datap, uint16_t offset, uint16_t size);
 void writeDataToFlash(uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data);
 void readDataFromFlash(uint16_t pageNumber, uint16_t offset, uint16_t dataSize, void *data);
 
@@ -272,8 +280,18 @@ void readDataFromFlash(uint16_t pageNumber, uint16_t offset, uint16_t dataSize,
 #define FLASH_OPCODE_LOWF_READ        0x03  // Opcode to perform a Continuous Array Read (Low Frequency)
 #define FLASH_OPCODE_BUF_WRITE        0x84  // Opcode to write into buffer
 #define FLASH_OPCODE_BUF_TO_PAGE      0x83  // Opcode to write buffer to given page
+#define FLASH_OPCODE_BUF2_WRITE       0x87  // Opcode to write into buffer 2
+#define FLASH_OPCODE_BUF2_TO_PAGE     0x86  // Opcode to write buffer 2 to given page
 #define FLASH_OPCODE_READ_DEV_INFO    0x9F  // Opcode to perform a Manufacturer and Device ID Read
 #define FLASH_READY_BITMASK           0x80  // Bitmask used to determine if the chip is ready (poll status register). Used with FLASH_OPCODE_READ_STAT_REG.
+#define FLASH_BUFFER_1                0     // Internal SRAM buffer IDs
+#define FLASH_BUFFER_2                1
+#define FLASH_NO_BUFFER               0xFF
+#if defined(FLASH_CHIP_1M)
+    #define FLASH_NB_BUFFERS          1     // The AT45DB011D only has one buffer
+#else
+    #define FLASH_NB_BUFFERS          2
+#endif
 #define FLASH_SECTOR_ZER0_A_PAGES     8
 #define FLASH_SECTOR_ZERO_A_CODE      0
 #define FLASH_SECTOR_ZERO_B_CODE      1
@@ -26,13 +26,16 @@
 *    Author:   Michael Neiderhauser
 */
 
+#include "usb_cmd_parser.h"
 #include "timer_manager.h"
 #include "oled_wrapper.h"
+#include "interrupts.h"
 #include "mooltipass.h"
 #include "flash_test.h"
 #include "flash_mem.h"
 #include "node_mgmt.h"
 #include "defines.h"
+#include "spi.h"
 #include "usb.h"
 
 #include <stdint.h>
@@ -765,3 +768,121 @@ RET_TYPE flashTest(void)
     displayPassed();
     return ret;
 }
+
+#ifdef ENABLE_FLASH_BENCHMARK
+/*!  \fn       flashBenchmarkOperation(uint8_t operation, uint8_t* buffer)
+*    \brief    Time an operation at the current SPI rate, send the result row over USB
+*    \param    operation  The operation (FLASH_BENCH_xxx)
+*    \param    buffer     A BYTES_PER_PAGE long buffer
+*/
+static void flashBenchmarkOperation(uint8_t operation, uint8_t* buffer)
+{
+    flashBenchmarkRow_t row;
+    uint32_t start, latency;
+    
+    memset(&row, 0, sizeof(row));
+    row.spi_rate = (uint8_t)UBRR1;
+    row.operation = operation;
+    row.min_latency = UINT32_MAX;
+    if (operation == FLASH_BENCH_SECTOR_ERASE)
+    {
+        row.nb_ops = 1;
+    }
+    else if (operation >= FLASH_BENCH_PAGE_ERASE)
+    {
+        row.nb_ops = FLASH_BENCH_NB_ERASES;
+    }
+    else
+    {
+        row.nb_ops = FLASH_BENCH_NB_OPS;
+    }
+    
+    for (uint16_t i = 0; i < row.nb_ops; i++)
+    {
+        start = getTimer1Timestamp();
+        switch (operation)
+        {
+            case FLASH_BENCH_READ :
+            {
+                readDataFromFlash(FLASH_BENCH_FIRST_PAGE + i, 0, BYTES_PER_PAGE, buffer);
+                row.nb_bytes += BYTES_PER_PAGE;
+                break;
+            }
+            case FLASH_BENCH_RAW_READ :
+            {
+                // Crosses a page boundary, flashRawRead only addresses the first 64kB
+                flashRawRead(buffer, (i * BYTES_PER_PAGE) + (BYTES_PER_PAGE / 2), BYTES_PER_PAGE);
+                row.nb_bytes += BYTES_PER_PAGE;
+                break;
+            }
+            case FLASH_BENCH_PARTIAL_WRITE :
+            {
+                writeDataToFlash(FLASH_BENCH_FIRST_PAGE + i, BYTES_PER_PAGE / 2, FLASH_BENCH_PARTIAL_SIZE, buffer);
+                row.nb_bytes += FLASH_BENCH_PARTIAL_SIZE;
+                break;
+            }
+            case FLASH_BENCH_BUFFER_TO_PAGE :
+            {
+                flashWriteBuffer(buffer, 0, BYTES_PER_PAGE);
+                flashWriteBufferToPage(FLASH_BENCH_FIRST_PAGE + i);
+                row.nb_bytes += BYTES_PER_PAGE;
+                break;
+            }
+            case FLASH_BENCH_PAGE_ERASE :
+            {
+                pageErase(FLASH_BENCH_FIRST_PAGE + i);
+                break;
+            }
+            case FLASH_BENCH_BLOCK_ERASE :
+            {
+                blockErase((FLASH_BENCH_FIRST_PAGE / 8) + i);
+                break;
+            }
+            default :
+            {
+                sectorErase(SECTOR_END);
+                break;
+            }
+        }
+        latency = getTimer1Timestamp() - start;
+        
+        row.total_time += latency;
+        if (latency < row.min_latency)
+        {
+            row.min_latency = latency;
+        }
+        if (latency > row.max_latency)
+        {
+            row.max_latency = latency;
+        }
+    }
+    
+    if ((row.total_time / FLASH_BENCH_TIME_DIVIDER) != 0)
+    {
+        row.bytes_per_s = (row.nb_bytes * (TIMER1_COUNTS_PER_MS * 1000UL / FLASH_BENCH_TIME_DIVIDER)) / (row.total_time / FLASH_BENCH_TIME_DIVIDER);
+    }
+    usbSendMessage(CMD_FLASH_BENCHMARK, sizeof(row), &row);
+}
+
+/*!  \fn       flashBenchmark()
+*    \brief    Time the flash operations at each SPI rate, one USB message per rate and operation
+*    \note     Erases the last sector, blocks for tens of seconds: only call it when no socket is being programmed
+*/
+void flashBenchmark(void)
+{
+    const uint8_t spi_rates[] = {SPI_RATE_8_MHZ, SPI_RATE_4_MHZ, SPI_RATE_2_MHZ, SPI_RATE_1_MHZ, SPI_RATE_800_KHZ, SPI_RATE_500_KHZ, SPI_RATE_400_KHZ, SPI_RATE_100_KHZ};
+    uint8_t buffer[BYTES_PER_PAGE];
+    uint16_t initial_rate = UBRR1;
+    
+    initBuffer(buffer, BYTES_PER_PAGE, FLASH_TEST_INIT_BUFFER_POLICY_INC);
+    for (uint8_t i = 0; i < sizeof(spi_rates); i++)
+    {
+        spiUsartSetRate(spi_rates[i]);
+        for (uint8_t operation = 0; operation < FLASH_BENCH_NB_OPERATIONS; operation++)
+        {
+            flashBenchmarkOperation(operation, buffer);
+        }
+    }
+    spiUsartSetRate(initial_rate);
+}
+#endif
@@ -46,6 +46,7 @@ RET_TYPE flashEraseSectorXTest(uint8_t* bufferIn, uint8_t* bufferOut, uint16_t b
 RET_TYPE flashEraseSectorZeroTest(uint8_t* bufferIn, uint8_t* bufferOut, uint16_t bufferSize);
 
 RET_TYPE flashTest(void);
+void flashBenchmark(void);
 
 
 // Flash Testing Defines
@@ -54,4 +55,32 @@ RET_TYPE flashTest(void);
 #define FLASH_TEST_INIT_BUFFER_POLICY_INC            2
 #define FLASH_TEST_INIT_BUFFER_POLICY_RND            3
 
+// Flash Benchmark Defines
+#define FLASH_BENCH_READ                             0   // readDataFromFlash, full page
+#define FLASH_BENCH_RAW_READ                         1   // flashRawRead, one page long from the middle of a page
+#define FLASH_BENCH_PARTIAL_WRITE                    2   // writeDataToFlash, FLASH_BENCH_PARTIAL_SIZE bytes
+#define FLASH_BENCH_BUFFER_TO_PAGE                   3   // flashWriteBuffer then flashWriteBufferToPage, full page
+#define FLASH_BENCH_PAGE_ERASE                       4
+#define FLASH_BENCH_BLOCK_ERASE                      5
+#define FLASH_BENCH_SECTOR_ERASE                     6
+#define FLASH_BENCH_NB_OPERATIONS                    7
+#define FLASH_BENCH_NB_OPS                           16  // Timed reads & writes per row
+#define FLASH_BENCH_NB_ERASES                        4   // Timed page & block erases per row, one sector erase
+#define FLASH_BENCH_PARTIAL_SIZE                     32
+#define FLASH_BENCH_FIRST_PAGE                       (SECTOR_END*PAGE_PER_SECTOR)   // Last sector, the one written & erased
+#define FLASH_BENCH_TIME_DIVIDER                     8   // Throughput computed in 4us units so that bytes * counts per second fits in 32 bits
+
+// One benchmark result, durations in 0.5us units
+typedef struct
+{
+    uint8_t spi_rate;               // UBRR1 value: SPI clock = 8MHz / (spi_rate + 1)
+    uint8_t operation;              // FLASH_BENCH_xxx
+    uint16_t nb_ops;
+    uint32_t nb_bytes;              // Data bytes of all the operations, 0 for erases
+    uint32_t bytes_per_s;
+    uint32_t total_time;
+    uint32_t min_latency;
+    uint32_t max_latency;
+} flashBenchmarkRow_t;
+
 #endif /* FLASH_TEST_H_ */
\ No newline at end of file
@@ -31,21 +31,19 @@
 #if defined(MINI_VERSION)
 
 
-/*! \fn     miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint16_t addr)
+/*! \fn     miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width)
  *  \brief  Initialise a bitstream ready for use
  *  \param  bs      pointer to the bitstream context to be used for the new bitmap
  *  \param  height  data height
  *  \param  width   data width
- *  \param  addr    address of the bitmap in SPI flash
+ *  \note   The data is pulled from a flash read session, opened by the caller at the bitmap data address
  */
-void miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint16_t addr)
+void miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width)
 {
     // In the data storage height can be any value but one y line is stored in blocks of 8bits (eg: 10pixels height > 2 bytes)
-    bs->addr = addr;
     bs->width = width;
     bs->height = height;
     bs->dataCounter = 0;
-    bs->bufferInd = sizeof(bs->buffer);
     bs->dataSize = (uint16_t)width * (((uint16_t)height+7) >> BITSTREAM_PIXELS_PER_BYTE_BITSHIFT);
 }
 
@@ -61,17 +59,8 @@ uint8_t miniBistreamGetNextByte(bitstream_mini_t* bs)
     {
         bs->dataCounter++;
         
-        // Check if we need to fetch new data from the SPI flash
-        if(bs->bufferInd >= sizeof(bs->buffer))
-        {
-            // Fetch new data from external flash
-            flashRawRead(bs->buffer, bs->addr, sizeof(bs->buffer));
-            bs->addr += sizeof(bs->buffer);
-            bs->bufferInd = 0;
-            //usbPrintf_P(PSTR("bistream buffer: %02x %02x %02x %02x %02x %02x"), bs->buffer[0], bs->buffer[1], bs->buffer[2], bs->buffer[3], bs->buffer[4], bs->buffer[5]);
-        }
-        
-         return bs->buffer[bs->bufferInd++];
+        // Clock the next byte out of the open flash read session
+        return flashReadStreamGetByte();
     }
     else
     {
@@ -29,7 +29,6 @@
 #define BITSTREAMMINI_H_
 
 /** BIT STREAM DEFINES **/
-#define BITSTREAM_BUFFER_SIZE               16  // Bitstream buffer size
 #define BITSTREAM_PIXELS_PER_BYTE_BITSHIFT  3   // Number of pixels per byte
 
 /** STRUCTS **/
@@ -39,13 +38,10 @@ typedef struct
     uint16_t width;             // number of pixels wide
     uint16_t dataSize;          // total data size
     uint16_t dataCounter;       // current counter
-    uint16_t addr;              // address of data in SPI FLASH store
-    uint8_t buffer[16];         // read ahead buffer
-    uint8_t bufferInd;          // read ahead buffer index
 } bitstream_mini_t;
 
 /** PROTOTYPES **/
 uint8_t miniBistreamGetNextByte(bitstream_mini_t* bs);
-void miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width, uint16_t addr);
+void miniBistreamInit(bitstream_mini_t* bs, uint8_t height, uint16_t width);
 
 #endif /* BITSTREAMMINI_H_ */
\ No newline at end of file
@@ -662,6 +662,7 @@ void miniOledSetFont(uint8_t fontIndex)
  *  \param  x       x position for the bitmap
  *  \param  y       y position for the bitmap (0=top, 63=bottom)
  *  \param  bs      pointer to the bitstream object
+ *  \note   The flash read session of the bitstream must be open
  */
 void miniOledBitmapDrawRaw(int8_t x, uint8_t y, bitstream_mini_t* bs)
 {
@@ -797,11 +798,12 @@ void miniOledBitmapDrawFlash(int8_t x, int8_t y, uint8_t fileId, uint8_t options
         return;
     }
 
-    // Read bitmap header
-    flashRawRead((uint8_t*)&bitmap, addr, sizeof(bitmap));
+    // Read bitmap header, keeping the read session open for the pixel data right after it
+    flashReadStreamOpen(addr);
+    flashReadStream((uint8_t*)&bitmap, sizeof(bitmap));
     
-    // Initialize bitstream (pixel data starts right after the header)
-    miniBistreamInit(&bs, bitmap.height, bitmap.width, addr+sizeof(bitmap));
+    // Initialize bitstream
+    miniBistreamInit(&bs, bitmap.height, bitmap.width);
     
     // Draw the bitmap
     if (y >= 0)
@@ -814,6 +816,7 @@ void miniOledBitmapDrawFlash(int8_t x, int8_t y, uint8_t fileId, uint8_t options
         miniOledBufferYOffset = (miniOledBufferYOffset - y) & SSD1305_OLED_HEIGHT_BITMASK;      // TODO: fix this line!
         miniOledBitmapDrawRaw(x, 0, &bs);
     }
+    flashReadStreamClose();
 
     // If we're asked to scroll or flip
     if (options != OLED_SCROLL_NONE)
@@ -994,8 +997,10 @@ uint8_t miniOledGlyphDraw(uint8_t x, uint8_t y, char ch)
         OLEDDEBUGPRINTF_P(PSTR("    glyph '%c' width %d height %d xoffset %d yoffset %d addr 0x%04x\n"), ch, glyph_width, glyph_height, glyph.xoffset, glyph.yoffset, gaddr);
         
         // Initialize bitstream & draw the character
-        miniBistreamInit(&bs, glyph_height, glyph_width, gaddr);   
+        flashReadStreamOpen(gaddr);
+        miniBistreamInit(&bs, glyph_height, glyph_width);
         miniOledBitmapDrawRaw((int8_t)x, y, &bs);
+        flashReadStreamClose();
     }
     
     return (uint8_t)(glyph_width + glyph.xoffset) + 1;
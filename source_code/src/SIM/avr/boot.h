@@ -0,0 +1,36 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     boot.h
+*    \brief    Host simulator: boot loader support
+*    Created:  17/10/2026
+*/
+#ifndef SIM_AVR_BOOT_H_
+#define SIM_AVR_BOOT_H_
+
+#include <avr/io.h>
+
+#define GET_LOW_FUSE_BITS           0
+#define GET_LOCK_BITS               1
+#define GET_EXTENDED_FUSE_BITS      2
+#define GET_HIGH_FUSE_BITS          3
+#define boot_lock_fuse_bits_get(addr)   ((uint8_t)0xFF)
+#define boot_signature_byte_get(addr)   ((uint8_t)0xFF)
+
+#endif /* SIM_AVR_BOOT_H_ */
@@ -0,0 +1,43 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     eeprom.h
+*    \brief    Host simulator: EEPROM kept in RAM
+*    Created:  17/10/2026
+*/
+#ifndef SIM_AVR_EEPROM_H_
+#define SIM_AVR_EEPROM_H_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define EEMEM
+
+uint8_t eeprom_read_byte(const uint8_t* addr);
+uint16_t eeprom_read_word(const uint16_t* addr);
+void eeprom_write_byte(uint8_t* addr, uint8_t value);
+void eeprom_write_word(uint16_t* addr, uint16_t value);
+void eeprom_read_block(void* dst, const void* addr, size_t size);
+void eeprom_write_block(const void* src, void* addr, size_t size);
+#define eeprom_update_byte  eeprom_write_byte
+#define eeprom_update_word  eeprom_write_word
+#define eeprom_update_block eeprom_write_block
+#define eeprom_busy_wait()
+
+#endif /* SIM_AVR_EEPROM_H_ */
@@ -0,0 +1,37 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     interrupt.h
+*    \brief    Host simulator: interrupt vectors and global interrupt flag
+*    Created:  17/10/2026
+*/
+#ifndef SIM_AVR_INTERRUPT_H_
+#define SIM_AVR_INTERRUPT_H_
+
+#include <avr/io.h>
+
+/* Vectors are plain functions, called by the simulator when their event occurs */
+#define ISR(vector, ...)    void vector(void); void vector(void)
+
+/* Interrupts raised while the I bit is cleared are delivered by sei() or the next tick */
+void simEnableInterrupts(void);
+#define sei()               simEnableInterrupts()
+#define cli()               (SREG &= ~(1 << SREG_I))
+
+#endif /* SIM_AVR_INTERRUPT_H_ */
@@ -0,0 +1,201 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     io.h
+*    \brief    Host simulator: AVR I/O registers as plain variables
+*    Created:  17/10/2026
+*/
+#ifndef SIM_AVR_IO_H_
+#define SIM_AVR_IO_H_
+
+#include <stdint.h>
+
+/* Registers are plain variables defined in sim_core.c, the ones with side effects go through an accessor */
+#define SIM_REG8(name)      extern volatile uint8_t name;
+#define SIM_REG16(name)     extern volatile uint16_t name;
+SIM_REG8(SREG)
+SIM_REG8(MCUCR)
+SIM_REG8(MCUSR)
+SIM_REG8(WDTCSR)
+SIM_REG8(PINB) SIM_REG8(DDRB) SIM_REG8(PORTB)
+SIM_REG8(PINC) SIM_REG8(DDRC) SIM_REG8(PORTC)
+SIM_REG8(PIND) SIM_REG8(DDRD) SIM_REG8(PORTD)
+SIM_REG8(PINE) SIM_REG8(DDRE) SIM_REG8(PORTE)
+SIM_REG8(PINF) SIM_REG8(DDRF) SIM_REG8(PORTF)
+SIM_REG8(EICRA) SIM_REG8(EICRB) SIM_REG8(EIMSK) SIM_REG8(EIFR)
+SIM_REG8(PCICR) SIM_REG8(PCIFR) SIM_REG8(PCMSK0)
+SIM_REG8(TCCR1A) SIM_REG8(TCCR1B) SIM_REG8(TCCR1C) SIM_REG8(TIMSK1) SIM_REG8(TIFR1)
+SIM_REG8(OCR1AH) SIM_REG8(OCR1AL) SIM_REG16(OCR1A)
+SIM_REG8(UCSR1A) SIM_REG8(UCSR1B) SIM_REG8(UCSR1C) SIM_REG8(UDR1) SIM_REG16(UBRR1)
+SIM_REG8(TWCR) SIM_REG8(TWDR) SIM_REG8(TWSR) SIM_REG8(TWBR)
+SIM_REG8(UHWCON) SIM_REG8(USBCON) SIM_REG8(UDCON) SIM_REG8(UDIEN) SIM_REG8(UDINT) SIM_REG8(UDADDR)
+SIM_REG8(UENUM) SIM_REG8(UERST)
+
+/* Flash chip select port, lets the DataFlash emulator see the chip select edges (see defines.h) */
+volatile uint8_t* simFlashChipSelectPort(void);
+
+/* I2C lines ports, let the bus emulator see every SCL / SDA edge (see defines.h) */
+volatile uint8_t* simI2cLineReg(volatile uint8_t* reg);
+
+/* USB controller registers having side effects, see sim_usb.c */
+#define SIM_UECONX          0
+#define SIM_UECFG0X         1
+#define SIM_UECFG1X         2
+#define SIM_UEIENX          3
+volatile uint8_t* simUsbPllReg(void);
+volatile uint8_t* simUsbIntReg(void);
+volatile uint8_t* simUsbDataReg(void);
+volatile uint8_t* simUsbEndpointReg(uint8_t reg);
+uint8_t simUsbGetEndpointInterrupts(void);
+#define PLLCSR              (*simUsbPllReg())
+#define UEINTX              (*simUsbIntReg())
+#define UEDATX              (*simUsbDataReg())
+#define UECONX              (*simUsbEndpointReg(SIM_UECONX))
+#define UECFG0X             (*simUsbEndpointReg(SIM_UECFG0X))
+#define UECFG1X             (*simUsbEndpointReg(SIM_UECFG1X))
+#define UEIENX              (*simUsbEndpointReg(SIM_UEIENX))
+#define UEINT               simUsbGetEndpointInterrupts()
+
+/* Timer1 counter, derived from the time elapsed since the last simulated tick */
+uint16_t simGetTimer1Counter(void);
+#define TCNT1               simGetTimer1Counter()
+
+/* Status register */
+#define SREG_I              7
+
+/* MCUCR / MCUSR / WDTCSR */
+#define JTD                 7
+#define WDRF                3
+#define WDIE                6
+#define WDP3                5
+#define WDCE                4
+#define WDE                 3
+#define WDP2                2
+#define WDP1                1
+#define WDP0                0
+
+/* External & pin change interrupts */
+#define ISC61               5
+#define ISC60               4
+#define INT6                6
+#define INTF6               6
+#define PCIE0               0
+#define PCIF0               0
+#define PCINT7              7
+#define PCINT6              6
+#define PCINT5              5
+#define PCINT4              4
+#define PCINT3              3
+#define PCINT2              2
+#define PCINT1              1
+#define PCINT0              0
+
+/* Timer1 */
+#define WGM13               4
+#define WGM12               3
+#define CS12                2
+#define CS11                1
+#define CS10                0
+#define OCIE1A              1
+#define OCF1A               1
+
+/* USART1 in SPI master mode */
+#define RXC1                7
+#define TXC1                6
+#define UDRE1               5
+#define RXEN1               4
+#define TXEN1               3
+#define UMSEL11             7
+#define UMSEL10             6
+#define UDORD1              2
+#define UCPHA1              1
+#define UCSZ10              1
+#define UCPOL1              0
+
+/* TWI */
+#define TWINT               7
+#define TWEA                6
+#define TWSTA               5
+#define TWSTO               4
+#define TWWC                3
+#define TWEN                2
+#define TWIE                0
+
+/* USB controller */
+#define UVREGE              0
+#define USBE                7
+#define FRZCLK              5
+#define OTGPADE             4
+#define PINDIV              4
+#define PLLE                1
+#define PLOCK               0
+#define DETACH              0
+#define EORSTE              3
+#define SOFE                2
+#define EORSTI              3
+#define SOFI                2
+#define ADDEN               7
+#define FIFOCON             7
+#define NAKINI              6
+#define RWAL                5
+#define NAKOUTI             4
+#define RXSTPI              3
+#define RXOUTI              2
+#define STALLEDI            1
+#define TXINI               0
+#define NAKINE              6
+#define NAKOUTE             4
+#define RXSTPE              3
+#define RXOUTE              2
+#define STALLEDE            1
+#define TXINE               0
+#define STALLRQ             5
+#define STALLRQC            4
+#define RSTDT               3
+#define EPEN                0
+
+/* Port bits */
+#define PORTB7 7
+#define PORTB6 6
+#define PORTB5 5
+#define PORTB4 4
+#define PORTB3 3
+#define PORTB2 2
+#define PORTB1 1
+#define PORTB0 0
+#define PORTC7 7
+#define PORTC6 6
+#define PORTD7 7
+#define PORTD6 6
+#define PORTD5 5
+#define PORTD4 4
+#define PORTD3 3
+#define PORTD2 2
+#define PORTD1 1
+#define PORTD0 0
+#define PORTE6 6
+#define PORTE2 2
+#define PORTF7 7
+#define PORTF6 6
+#define PORTF5 5
+#define PORTF4 4
+#define PORTF1 1
+#define PORTF0 0
+
+#endif /* SIM_AVR_IO_H_ */
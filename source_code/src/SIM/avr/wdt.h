@@ -0,0 +1,36 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     wdt.h
+*    \brief    Host simulator: watchdog
+*    Created:  17/10/2026
+*/
+#ifndef SIM_AVR_WDT_H_
+#define SIM_AVR_WDT_H_
+
+#include <avr/io.h>
+
+#define WDTO_15MS           0
+#define WDTO_2S             7
+#define WDTO_8S             9
+#define wdt_reset()
+#define wdt_enable(timeout)
+#define wdt_disable()
+
+#endif /* SIM_AVR_WDT_H_ */
@@ -0,0 +1,453 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     sim_at45.c
+*    \brief    Host simulator: AT45 DataFlash behind the SPI USART
+*    Created:  17/10/2026
+*
+*    Replaces the spiUsart transfers and sees the flash chip select through
+*    PORT_FLASH_nS, so flash_mem.c runs unmodified. Each byte is decoded
+*    like the chip does: status & ID reads, continuous array read, buffer
+*    writes, buffer/page transfers, programs and erases. Programs and
+*    erases keep the chip busy for their typical datasheet time, commands
+*    other than a status read or a write to the idle buffer are ignored
+*    while it is busy, like the chip does.
+*
+*    Time only advances with the SPI clock (UBRR1), so a busy wait costs
+*    the status polls it takes. "flash stats" on stdin prints the number
+*    of bytes and commands, the ignored commands and the simulated us,
+*    "flash reset" clears them.
+*/
+#include <string.h>
+#include <avr/io.h>
+#include "flash_mem.h"
+#include "sim_core.h"
+#include "defines.h"
+#include "spi.h"
+
+/* Buffer used by an opcode */
+#define SIM_AT45_NO_BUFFER      0xFF
+/* Status register density code */
+#if FLASH_CHIP == 1
+    #define SIM_AT45_DENSITY    0x03
+#elif FLASH_CHIP == 2
+    #define SIM_AT45_DENSITY    0x05
+#elif FLASH_CHIP == 4
+    #define SIM_AT45_DENSITY    0x07
+#elif FLASH_CHIP == 8
+    #define SIM_AT45_DENSITY    0x09
+#elif FLASH_CHIP == 16
+    #define SIM_AT45_DENSITY    0x0B
+#else
+    #define SIM_AT45_DENSITY    0x0D
+#endif
+
+/* Memory array and SRAM buffers */
+static uint8_t sim_at45_array[PAGE_COUNT][BYTES_PER_PAGE];
+static uint8_t sim_at45_buffers[2][BYTES_PER_PAGE];
+/* Chip select, written through PORT_FLASH_nS */
+static volatile uint8_t sim_at45_cs_port;
+static uint8_t sim_at45_selected;
+/* Command being clocked in */
+static uint8_t sim_at45_command[4];
+static uint16_t sim_at45_nb_bytes;
+static uint8_t sim_at45_ignored;
+static uint16_t sim_at45_page;
+static uint16_t sim_at45_offset;
+/* Operation in progress */
+static uint64_t sim_at45_busy_until_ns;
+static uint8_t sim_at45_busy_buffer = SIM_AT45_NO_BUFFER;
+/* Statistics */
+static uint64_t sim_at45_time_ns;
+static uint64_t sim_at45_nb_spi_bytes;
+static uint32_t sim_at45_nb_commands;
+static uint32_t sim_at45_nb_ignored;
+
+
+/*! \fn     simAt45OpcodeBuffer(uint8_t opcode)
+*   \brief  Know which SRAM buffer an opcode uses
+*   \param  opcode  The opcode
+*   \return The buffer ID, SIM_AT45_NO_BUFFER if none
+*/
+static uint8_t simAt45OpcodeBuffer(uint8_t opcode)
+{
+    switch (opcode)
+    {
+        case 0x53: case 0x82: case 0x83: case 0x84: case 0x88: return 0;
+        case 0x55: case 0x85: case 0x86: case 0x87: case 0x89: return 1;
+        default: return SIM_AT45_NO_BUFFER;
+    }
+}
+
+/*! \fn     simAt45SetBusy(uint32_t busy_us, uint8_t buffer_id)
+*   \brief  Start an internal operation
+*   \param  busy_us     Its duration
+*   \param  buffer_id   The buffer it uses, SIM_AT45_NO_BUFFER if none
+*/
+static void simAt45SetBusy(uint32_t busy_us, uint8_t buffer_id)
+{
+    sim_at45_busy_until_ns = sim_at45_time_ns + (uint64_t)busy_us * 1000;
+    sim_at45_busy_buffer = buffer_id;
+}
+
+/*! \fn     simAt45IsBusy(void)
+*   \brief  Know if an internal operation is in progress
+*   \return TRUE or FALSE
+*/
+static uint8_t simAt45IsBusy(void)
+{
+    return (sim_at45_time_ns < sim_at45_busy_until_ns) ? TRUE : FALSE;
+}
+
+/*! \fn     simAt45Erase(uint16_t first_page, uint16_t nb_pages)
+*   \brief  Erase a page range
+*   \param  first_page  The first page
+*   \param  nb_pages    The number of pages
+*/
+static void simAt45Erase(uint16_t first_page, uint16_t nb_pages)
+{
+    memset(sim_at45_array[first_page], 0xFF, (uint32_t)nb_pages * BYTES_PER_PAGE);
+}
+
+/*! \fn     simAt45EndCommand(void)
+*   \brief  Chip select deasserted: start the internal operation of the command
+*/
+static void simAt45EndCommand(void)
+{
+    uint8_t opcode = sim_at45_command[0];
+    uint8_t buffer_id = simAt45OpcodeBuffer(opcode);
+    
+    // Commands are only executed once their address is complete
+    if ((sim_at45_ignored != FALSE) || (sim_at45_nb_bytes < 4))
+    {
+        return;
+    }
+    
+    switch (opcode)
+    {
+        case 0x53 :
+        case 0x55 :
+        {
+            memcpy(sim_at45_buffers[buffer_id], sim_at45_array[sim_at45_page], BYTES_PER_PAGE);
+            simAt45SetBusy(SIM_AT45_TXFR_US, buffer_id);
+            break;
+        }
+        case 0x82 :
+        case 0x83 :
+        case 0x85 :
+        case 0x86 :
+        {
+            memcpy(sim_at45_array[sim_at45_page], sim_at45_buffers[buffer_id], BYTES_PER_PAGE);
+            simAt45SetBusy(SIM_AT45_EP_US, buffer_id);
+            break;
+        }
+        case 0x88 :
+        case 0x89 :
+        {
+            for (uint16_t i = 0; i < BYTES_PER_PAGE; i++)
+            {
+                sim_at45_array[sim_at45_page][i] &= sim_at45_buffers[buffer_id][i];
+            }
+            simAt45SetBusy(SIM_AT45_P_US, buffer_id);
+            break;
+        }
+        case FLASH_OPCODE_PAGE_ERASE :
+        {
+            simAt45Erase(sim_at45_page, 1);
+            simAt45SetBusy(SIM_AT45_PE_US, SIM_AT45_NO_BUFFER);
+            break;
+        }
+        case FLASH_OPCODE_BLOCK_ERASE :
+        {
+            simAt45Erase(sim_at45_page & ~0x07, 8);
+            simAt45SetBusy(SIM_AT45_BE_US, SIM_AT45_NO_BUFFER);
+            break;
+        }
+        case FLASH_OPCODE_SECTOR_ERASE :
+        {
+            // Sector 0 is split in 0a (block 0) and 0b (the rest of it)
+            if (sim_at45_page < 8)
+            {
+                simAt45Erase(0, 8);
+            }
+            else if (sim_at45_page < PAGE_PER_SECTOR)
+            {
+                simAt45Erase(8, PAGE_PER_SECTOR - 8);
+            }
+            else
+            {
+                simAt45Erase(sim_at45_page - (sim_at45_page % PAGE_PER_SECTOR), PAGE_PER_SECTOR);
+            }
+            simAt45SetBusy(SIM_AT45_SE_US, SIM_AT45_NO_BUFFER);
+            break;
+        }
+        case 0xC7 :
+        {
+            if ((sim_at45_command[1] == 0x94) && (sim_at45_command[2] == 0x80) && (sim_at45_command[3] == 0x9A))
+            {
+                simAt45Erase(0, PAGE_COUNT);
+                simAt45SetBusy(SIM_AT45_CE_US, SIM_AT45_NO_BUFFER);
+            }
+            break;
+        }
+        default : break;
+    }
+}
+
+/*! \fn     simAt45SyncChipSelect(void)
+*   \brief  Follow the chip select, as last written to PORT_FLASH_nS
+*/
+static void simAt45SyncChipSelect(void)
+{
+    uint8_t selected = (sim_at45_cs_port & (1 << PORTID_FLASH_nS)) ? FALSE : TRUE;
+    
+    if (selected == sim_at45_selected)
+    {
+        return;
+    }
+    sim_at45_selected = selected;
+    if (selected != FALSE)
+    {
+        sim_at45_nb_bytes = 0;
+        sim_at45_ignored = FALSE;
+    }
+    else
+    {
+        simAt45EndCommand();
+    }
+}
+
+/*! \fn     simFlashChipSelectPort(void)
+*   \brief  PORT_FLASH_nS: the write of the previous access is seen before the register is returned
+*   \return Pointer to the chip select port
+*/
+volatile uint8_t* simFlashChipSelectPort(void)
+{
+    simEnterModel();
+    simAt45SyncChipSelect();
+    simLeaveModel();
+    return &sim_at45_cs_port;
+}
+
+/*! \fn     simAt45StartCommand(uint8_t opcode)
+*   \brief  First byte of a command: check that the chip can accept it
+*   \param  opcode  The opcode
+*/
+static void simAt45StartCommand(uint8_t opcode)
+{
+    uint8_t buffer_id = simAt45OpcodeBuffer(opcode);
+    
+    sim_at45_nb_commands++;
+    if ((simAt45IsBusy() == FALSE) || (opcode == FLASH_OPCODE_READ_STAT_REG))
+    {
+        return;
+    }
+    
+    // Only the buffer the operation in progress doesn't use can be written
+    if (((opcode == FLASH_OPCODE_BUF_WRITE) || (opcode == FLASH_OPCODE_BUF2_WRITE)) && (sim_at45_busy_buffer != SIM_AT45_NO_BUFFER) && (buffer_id != sim_at45_busy_buffer))
+    {
+        return;
+    }
+    sim_at45_ignored = TRUE;
+    sim_at45_nb_ignored++;
+    simPrintf("flash opcode 0x%02X ignored, busy\n", opcode);
+}
+
+/*! \fn     simAt45Transfer(uint8_t data)
+*   \brief  Clock a byte to and from the DataFlash
+*   \param  data    The byte to send
+*   \return The received byte
+*/
+static uint8_t simAt45Transfer(uint8_t data)
+{
+    uint8_t opcode = sim_at45_command[0];
+    uint8_t miso = 0xFF;
+    uint32_t address;
+    
+    simAt45SyncChipSelect();
+    sim_at45_nb_spi_bytes++;
+    sim_at45_time_ns += SIM_AT45_SPI_BYTE_NS(UBRR1);
+    
+    // MISO isn't driven when the chip isn't selected
+    if (sim_at45_selected == FALSE)
+    {
+        return miso;
+    }
+    
+    if (sim_at45_nb_bytes < sizeof(sim_at45_command))
+    {
+        sim_at45_command[sim_at45_nb_bytes] = data;
+    }
+    
+    if (sim_at45_nb_bytes == 0)
+    {
+        simAt45StartCommand(data);
+    }
+    else if (sim_at45_ignored == FALSE)
+    {
+        if (opcode == FLASH_OPCODE_READ_STAT_REG)
+        {
+            miso = (simAt45IsBusy() ? 0x00 : FLASH_READY_BITMASK) | (SIM_AT45_DENSITY << 2);
+        }
+        else if (opcode == FLASH_OPCODE_READ_DEV_INFO)
+        {
+            const uint8_t id[] = {FLASH_MANUF_ID, MAN_FAM_DEN_VAL, 0x01, 0x00};
+            miso = (sim_at45_nb_bytes <= sizeof(id)) ? id[sim_at45_nb_bytes - 1] : 0x00;
+        }
+        else if ((opcode == FLASH_OPCODE_LOWF_READ) && (sim_at45_nb_bytes >= 4))
+        {
+            // The continuous read goes on with the next page, then wraps to the start of the array
+            miso = sim_at45_array[sim_at45_page][sim_at45_offset++];
+            if (sim_at45_offset == BYTES_PER_PAGE)
+            {
+                sim_at45_offset = 0;
+                sim_at45_page = (sim_at45_page + 1) % PAGE_COUNT;
+            }
+        }
+        else if ((simAt45OpcodeBuffer(opcode) != SIM_AT45_NO_BUFFER) && (opcode != 0x53) && (opcode != 0x55) && (sim_at45_nb_bytes >= 4))
+        {
+            // Buffer writes wrap to the start of the buffer
+            sim_at45_buffers[simAt45OpcodeBuffer(opcode)][sim_at45_offset] = data;
+            sim_at45_offset = (sim_at45_offset + 1) % BYTES_PER_PAGE;
+        }
+    }
+    
+    // Address complete: 24 bits, page above the offset bits
+    if (sim_at45_nb_bytes == 3)
+    {
+        address = ((uint32_t)sim_at45_command[1] << 16) | ((uint32_t)sim_at45_command[2] << 8) | sim_at45_command[3];
+        sim_at45_page = (address >> READ_OFFSET_SHT_AMT) % PAGE_COUNT;
+        sim_at45_offset = (address & ((1UL << READ_OFFSET_SHT_AMT) - 1)) % BYTES_PER_PAGE;
+    }
+    if (sim_at45_nb_bytes != UINT16_MAX)
+    {
+        sim_at45_nb_bytes++;
+    }
+    return miso;
+}
+
+/*! \fn     spiUsartTransfer(uint8_t data)
+*   \brief  Clock a byte to and from the DataFlash, the control commands wait for the end of it
+*   \param  data    The byte to send
+*   \return The received byte
+*/
+uint8_t spiUsartTransfer(uint8_t data)
+{
+    uint8_t miso;
+    
+    simEnterModel();
+    miso = simAt45Transfer(data);
+    simLeaveModel();
+    return miso;
+}
+
+/*! \fn     spiUsartRead(uint8_t* data, uint16_t size)
+*   \brief  Clock bytes from the DataFlash
+*   \param  data    Where to store the received bytes
+*   \param  size    The number of bytes
+*/
+void spiUsartRead(uint8_t* data, uint16_t size)
+{
+    while (size--)
+    {
+        *data++ = spiUsartTransfer(0);
+    }
+}
+
+/*! \fn     spiUsartWrite(uint8_t* data, uint16_t size)
+*   \brief  Clock bytes to the DataFlash
+*   \param  data    The bytes to send
+*   \param  size    The number of bytes
+*/
+void spiUsartWrite(uint8_t* data, uint16_t size)
+{
+    while (size--)
+    {
+        spiUsartTransfer(*data++);
+    }
+}
+
+/*! \fn     spiUsartReadWrite(uint8_t* data, uint16_t size)
+*   \brief  Clock bytes to and from the DataFlash
+*   \param  data    The bytes to send, overwritten with the received ones
+*   \param  size    The number of bytes
+*/
+void spiUsartReadWrite(uint8_t* data, uint16_t size)
+{
+    while (size--)
+    {
+        *data = spiUsartTransfer(*data);
+        data++;
+    }
+}
+
+/*! \fn     simAt45GetSpiBytes(void)
+*   \brief  Number of bytes clocked on the SPI USART since the last reset
+*   \return The number of bytes
+*/
+uint64_t simAt45GetSpiBytes(void)
+{
+    return sim_at45_nb_spi_bytes;
+}
+
+/*! \fn     simAt45GetTimeUs(void)
+*   \brief  Simulated time since the last reset
+*   \return The number of us
+*/
+uint64_t simAt45GetTimeUs(void)
+{
+    return sim_at45_time_ns / 1000;
+}
+
+/*! \fn     simAt45ResetStats(void)
+*   \brief  Clear the statistics, an operation in progress keeps its remaining time
+*/
+void simAt45ResetStats(void)
+{
+    sim_at45_busy_until_ns = simAt45IsBusy() ? (sim_at45_busy_until_ns - sim_at45_time_ns) : 0;
+    sim_at45_time_ns = 0;
+    sim_at45_nb_spi_bytes = 0;
+    sim_at45_nb_commands = 0;
+    sim_at45_nb_ignored = 0;
+}
+
+/*! \fn     simAt45Control(char* command)
+*   \brief  Run a "flash" control command
+*   \param  command     The command line
+*/
+void simAt45Control(char* command)
+{
+    simAt45SyncChipSelect();
+    if (strcmp(command, "flash stats") == 0)
+    {
+        simLog("flash bytes %llu commands %llu ignored %llu us %llu\n", (unsigned long long)sim_at45_nb_spi_bytes, (unsigned long long)sim_at45_nb_commands, (unsigned long long)sim_at45_nb_ignored, (unsigned long long)simAt45GetTimeUs());
+    }
+    else if (strcmp(command, "flash reset") == 0)
+    {
+        simAt45ResetStats();
+    }
+}
+
+/*! \fn     simAt45Init(void)
+*   \brief  Power on state: erased array
+*/
+void simAt45Init(void)
+{
+    memset(sim_at45_array, 0xFF, sizeof(sim_at45_array));
+}
@@ -0,0 +1,621 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     sim_core.c
+*    \brief    Host simulator core: registers, interrupts and simulated tick
+*    Created:  17/10/2026
+*
+*    The firmware runs unmodified as a Linux process: main() is the one of
+*    mooltipass.c and the AVR registers are plain variables (see avr/io.h).
+*    The ones having side effects go through accessors into the peripheral
+*    models: TWI controller and I2C lines in sim_i2c_bus.c, USB controller
+*    in sim_usb.c, DataFlash chip select in sim_at45.c.
+*
+*    A SIGALRM handler firing every tick plays the hardware: it steps the
+*    peripheral models, which raise their interrupt flags, then runs the
+*    vectors the firmware enabled. It doesn't touch any file descriptor but
+*    the I/O thread wake up one. That thread owns stdin, stdout and the USB
+*    host socket, it exchanges lines and packets with the firmware through
+*    single producer / single consumer rings.
+*
+*    An interrupt raised while the I bit of SREG is cleared is delivered by
+*    the next sei() or the next tick, as the handler can't hook the writes
+*    restoring SREG. A tick firing while a model accessor is running is
+*    caught up by the next one.
+*/
+#define _GNU_SOURCE
+#include <sys/eventfd.h>
+#include <sys/time.h>
+#include <avr/interrupt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <poll.h>
+#include <time.h>
+#include "sim_core.h"
+#include "defines.h"
+
+/* Registers */
+volatile uint8_t SREG;
+volatile uint8_t MCUCR, MCUSR, WDTCSR;
+volatile uint8_t PINB, DDRB, PORTB;
+volatile uint8_t PINC, DDRC, PORTC;
+volatile uint8_t PIND, DDRD, PORTD;
+volatile uint8_t PINE, DDRE, PORTE;
+volatile uint8_t PINF, DDRF, PORTF;
+volatile uint8_t EICRA, EICRB, EIMSK, EIFR;
+volatile uint8_t PCICR, PCIFR, PCMSK0;
+volatile uint8_t TCCR1A, TCCR1B, TCCR1C, TIMSK1, TIFR1;
+volatile uint8_t OCR1AH, OCR1AL;
+volatile uint16_t OCR1A;
+volatile uint8_t UCSR1A, UCSR1B, UCSR1C, UDR1;
+volatile uint16_t UBRR1;
+volatile uint8_t TWCR, TWDR, TWSR, TWBR;
+volatile uint8_t UHWCON, USBCON, UDCON, UDIEN, UDINT, UDADDR;
+volatile uint8_t UENUM, UERST;
+/* Ticks raised by the signal handler, stepped by the peripheral models and delivered to the firmware */
+static volatile sig_atomic_t sim_ticks_raised;
+static volatile sig_atomic_t sim_ticks_stepped;
+static volatile sig_atomic_t sim_ticks_delivered;
+static volatile uint8_t sim_in_interrupt;
+/* Non zero while the firmware thread is inside a peripheral model */
+static volatile sig_atomic_t sim_model_depth;
+/* Time of the last raised tick, for the Timer1 counter */
+static struct timespec sim_last_tick;
+static long sim_tick_ns;
+/* Lines to print, formatted by the firmware thread or later by the I/O thread */
+typedef struct
+{
+    const char* fmt;
+    unsigned long long args[SIM_LOG_NB_ARGS];
+    char text[SIM_LOG_LINE_LENGTH];
+} simLogLine_t;
+static simLogLine_t sim_log_ring[SIM_LOG_RING_SIZE];
+static uint32_t sim_log_head;
+static uint32_t sim_log_tail;
+/* Control commands read on stdin by the I/O thread */
+static char sim_control_ring[SIM_CONTROL_RING_SIZE][SIM_CONTROL_LINE_LENGTH];
+static uint32_t sim_control_head;
+static uint32_t sim_control_tail;
+static char sim_control_line[SIM_CONTROL_LINE_LENGTH];
+static uint8_t sim_control_line_len;
+/* I/O thread and its wake up event */
+static pthread_t sim_io_thread;
+static uint8_t sim_io_thread_running = FALSE;
+static __thread uint8_t sim_is_io_thread = FALSE;
+static int sim_wake_fd = -1;
+
+static void simIoPrintLines(void);
+
+
+/*! \fn     simEnterModel(void)
+*   \brief  Start a peripheral model update: the tick handler leaves the models alone until simLeaveModel()
+*/
+void simEnterModel(void)
+{
+    sim_model_depth++;
+}
+
+/*! \fn     simLeaveModel(void)
+*   \brief  End a peripheral model update
+*/
+void simLeaveModel(void)
+{
+    sim_model_depth--;
+}
+
+/*! \fn     simWakeIoThread(void)
+*   \brief  Have the I/O thread look at the rings, usable from the tick handler
+*/
+void simWakeIoThread(void)
+{
+    uint64_t one = 1;
+    
+    if (sim_wake_fd >= 0)
+    {
+        (void)!write(sim_wake_fd, &one, sizeof(one));
+    }
+}
+
+/*! \fn     simLogReserve(void)
+*   \brief  Get the next free line of the print ring, waiting for the I/O thread if it is full
+*   \return The line, published by simLogCommit()
+*/
+static simLogLine_t* simLogReserve(void)
+{
+    while ((sim_log_head - __atomic_load_n(&sim_log_tail, __ATOMIC_ACQUIRE)) >= SIM_LOG_RING_SIZE)
+    {
+        simWakeIoThread();
+        sched_yield();
+    }
+    return &sim_log_ring[sim_log_head & SIM_LOG_RING_MASK];
+}
+
+/*! \fn     simLogCommit(void)
+*   \brief  Hand the line returned by simLogReserve() to the I/O thread
+*/
+static void simLogCommit(void)
+{
+    __atomic_store_n(&sim_log_head, sim_log_head + 1, __ATOMIC_RELEASE);
+    simWakeIoThread();
+}
+
+/*! \fn     simPrintf(const char* fmt, ...)
+*   \brief  Print a line on stdout, not from the tick handler (see simLog())
+*   \param  fmt     The format
+*/
+void simPrintf(const char* fmt, ...)
+{
+    char buffer[SIM_LOG_LINE_LENGTH];
+    simLogLine_t* line;
+    va_list ap;
+    int len;
+    
+    if ((sim_io_thread_running == FALSE) || (sim_is_io_thread != FALSE))
+    {
+        // Test modes, before main() or from the I/O thread: printed right away, after the queued lines
+        if (sim_is_io_thread != FALSE)
+        {
+            simIoPrintLines();
+        }
+        va_start(ap, fmt);
+        len = vsnprintf(buffer, sizeof(buffer), fmt, ap);
+        va_end(ap);
+        if (len > (int)sizeof(buffer) - 1)
+        {
+            len = sizeof(buffer) - 1;
+        }
+        if (len > 0)
+        {
+            (void)!write(STDOUT_FILENO, buffer, len);
+        }
+        return;
+    }
+    
+    simEnterModel();
+    line = simLogReserve();
+    line->fmt = 0;
+    va_start(ap, fmt);
+    vsnprintf(line->text, sizeof(line->text), fmt, ap);
+    va_end(ap);
+    simLogCommit();
+    simLeaveModel();
+}
+
+/*! \fn     simLog(const char* fmt, ...)
+*   \brief  Queue a line the I/O thread formats and prints, usable from the tick handler
+*   \param  fmt     The format, each of its conversions taking an unsigned long long
+*/
+void simLog(const char* fmt, ...)
+{
+    simLogLine_t* line;
+    uint8_t nb_args = 0;
+    va_list ap;
+    
+    if (sim_io_thread_running == FALSE)
+    {
+        return;
+    }
+    
+    simEnterModel();
+    line = simLogReserve();
+    line->fmt = fmt;
+    va_start(ap, fmt);
+    for (const char* c = fmt; (*c != 0) && (nb_args < SIM_LOG_NB_ARGS); c++)
+    {
+        if ((c[0] == '%') && (c[1] == '%'))
+        {
+            c++;
+        }
+        else if (c[0] == '%')
+        {
+            line->args[nb_args++] = va_arg(ap, unsigned long long);
+        }
+    }
+    va_end(ap);
+    simLogCommit();
+    simLeaveModel();
+}
+
+/*! \fn     simIsInInterrupt(void)
+*   \brief  Know if the caller runs from a simulated interrupt
+*   \return TRUE or FALSE
+*/
+uint8_t simIsInInterrupt(void)
+{
+    return sim_in_interrupt;
+}
+
+/*! \fn     simGetTimer1Counter(void)
+*   \brief  Timer1 counter value, from the time elapsed since the last tick
+*   \return The counter value, 2000 counts per tick
+*/
+uint16_t simGetTimer1Counter(void)
+{
+    struct timespec now;
+    long elapsed_ns;
+    
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed_ns = (now.tv_sec - sim_last_tick.tv_sec) * 1000000000L + (now.tv_nsec - sim_last_tick.tv_nsec);
+    if (elapsed_ns >= sim_tick_ns)
+    {
+        return 1999;
+    }
+    return (uint16_t)((elapsed_ns * 2000) / sim_tick_ns);
+}
+
+/*! \fn     simDelayUs(double us)
+*   \brief  Busy wait, like _delay_us. The I2C buses see the line levels set before the wait
+*   \param  us  Number of us
+*/
+void simDelayUs(double us)
+{
+    struct timespec start, now;
+    
+    simI2cSyncLines();
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    do
+    {
+        clock_gettime(CLOCK_MONOTONIC, &now);
+    }
+    while (((now.tv_sec - start.tv_sec) * 1e6 + (now.tv_nsec - start.tv_nsec) / 1e3) < us);
+}
+
+/*! \fn     simSetInputPin(volatile uint8_t* pin_reg, uint8_t bitmask, uint8_t level)
+*   \brief  Drive an input pin, running the pin change & external interrupt vectors the firmware enabled
+*   \param  pin_reg     The PINx register
+*   \param  bitmask     The pin bitmask
+*   \param  level       0 for low, any other value for high
+*/
+void simSetInputPin(volatile uint8_t* pin_reg, uint8_t bitmask, uint8_t level)
+{
+    uint8_t old_val = *pin_reg;
+    uint8_t new_val = level ? (old_val | bitmask) : (old_val & ~bitmask);
+    
+    if (old_val == new_val)
+    {
+        return;
+    }
+    *pin_reg = new_val;
+    
+    // Vectors are only run from interrupt context, the tick sampling catches up otherwise
+    if (sim_in_interrupt == FALSE)
+    {
+        return;
+    }
+    if ((pin_reg == &PINB) && (PCICR & (1 << PCIE0)) && (PCMSK0 & bitmask))
+    {
+        PCINT0_vect();
+    }
+    if ((pin_reg == &PINE) && (bitmask & (1 << INT6)) && (EIMSK & (1 << INT6)) && (level == 0))
+    {
+        INT6_vect();
+    }
+}
+
+/*! \fn     simRunControlCommands(void)
+*   \brief  Run the control commands queued by the I/O thread
+*/
+static void simRunControlCommands(void)
+{
+    char* command;
+    
+    while (sim_control_tail != __atomic_load_n(&sim_control_head, __ATOMIC_ACQUIRE))
+    {
+        command = sim_control_ring[sim_control_tail & SIM_CONTROL_RING_MASK];
+        if (strncmp(command, "flash", 5) == 0)
+        {
+            simAt45Control(command);
+        }
+        else
+        {
+            simPcaControl(command);
+        }
+        __atomic_store_n(&sim_control_tail, sim_control_tail + 1, __ATOMIC_RELEASE);
+        simWakeIoThread();
+    }
+}
+
+/*! \fn     simStepPeripherals(void)
+*   \brief  Advance the peripheral models by the ticks raised since the last step
+*/
+static void simStepPeripherals(void)
+{
+    while (sim_ticks_stepped != sim_ticks_raised)
+    {
+        sim_ticks_stepped++;
+        simUsbTick();
+        simTwiTick();
+    }
+}
+
+/*! \fn     simInterruptsPending(void)
+*   \brief  Know if a raised interrupt or a control command waits for delivery
+*   \return TRUE or FALSE
+*/
+static uint8_t simInterruptsPending(void)
+{
+    if ((sim_ticks_delivered != sim_ticks_raised) || (sim_control_tail != __atomic_load_n(&sim_control_head, __ATOMIC_ACQUIRE)))
+    {
+        return TRUE;
+    }
+    return (simUsbGenPending() || simUsbComPending() || simTwiPending()) ? TRUE : FALSE;
+}
+
+/*! \fn     simDeliverInterrupts(void)
+*   \brief  Run the interrupts raised since the last delivery, with the I bit cleared like the hardware does
+*/
+static void simDeliverInterrupts(void)
+{
+    uint8_t delivered;
+    
+    sim_in_interrupt = TRUE;
+    do
+    {
+        delivered = FALSE;
+        SREG &= ~(1 << SREG_I);
+        simRunControlCommands();
+        // Vector priority order
+        if (simUsbGenPending())
+        {
+            USB_GEN_vect();
+            delivered = TRUE;
+        }
+        if (simUsbComPending())
+        {
+            USB_COM_vect();
+            delivered = TRUE;
+        }
+        if (sim_ticks_delivered != sim_ticks_raised)
+        {
+            sim_ticks_delivered++;
+            TIFR1 &= ~(1 << OCF1A);
+            if (TIMSK1 & (1 << OCIE1A))
+            {
+                TIMER1_COMPA_vect();
+            }
+            delivered = TRUE;
+        }
+        if (simTwiPending())
+        {
+            TWI_vect();
+            // The controller carries on with the command the vector wrote
+            simTwiRun();
+            delivered = TRUE;
+        }
+        SREG |= (1 << SREG_I);
+    }
+    while (delivered != FALSE);
+    sim_in_interrupt = FALSE;
+}
+
+/*! \fn     simEnableInterrupts(void)
+*   \brief  sei(): set the I bit and deliver the pending interrupts
+*/
+void simEnableInterrupts(void)
+{
+    sigset_t alarm_set, old_set;
+    
+    SREG |= (1 << SREG_I);
+    if ((sim_in_interrupt == FALSE) && (simInterruptsPending() != FALSE))
+    {
+        // The tick handler must not deliver in the middle of our own delivery
+        sigemptyset(&alarm_set);
+        sigaddset(&alarm_set, SIGALRM);
+        sigprocmask(SIG_BLOCK, &alarm_set, &old_set);
+        simStepPeripherals();
+        simDeliverInterrupts();
+        sigprocmask(SIG_SETMASK, &old_set, 0);
+    }
+}
+
+/*! \fn     simTickHandler(int signum)
+*   \brief  SIGALRM handler: raises the Timer1 compare interrupt, steps the peripheral models and delivers
+*   \param  signum  Unused
+*/
+static void simTickHandler(int signum)
+{
+    (void)signum;
+    clock_gettime(CLOCK_MONOTONIC, &sim_last_tick);
+    sim_ticks_raised++;
+    TIFR1 |= (1 << OCF1A);
+    if (sim_model_depth != 0)
+    {
+        return;
+    }
+    simStepPeripherals();
+    if ((SREG & (1 << SREG_I)) && (sim_in_interrupt == FALSE))
+    {
+        simDeliverInterrupts();
+    }
+}
+
+/*! \fn     simIoPrintLines(void)
+*   \brief  I/O thread: print the queued lines
+*/
+static void simIoPrintLines(void)
+{
+    simLogLine_t* line;
+    char buffer[SIM_LOG_LINE_LENGTH];
+    const char* text;
+    int len;
+    
+    while (sim_log_tail != __atomic_load_n(&sim_log_head, __ATOMIC_ACQUIRE))
+    {
+        line = &sim_log_ring[sim_log_tail & SIM_LOG_RING_MASK];
+        text = line->text;
+        if (line->fmt != 0)
+        {
+            snprintf(buffer, sizeof(buffer), line->fmt, line->args[0], line->args[1], line->args[2], line->args[3]);
+            text = buffer;
+        }
+        len = strlen(text);
+        (void)!write(STDOUT_FILENO, text, len);
+        __atomic_store_n(&sim_log_tail, sim_log_tail + 1, __ATOMIC_RELEASE);
+    }
+}
+
+/*! \fn     simIoReadControl(void)
+*   \brief  I/O thread: queue the control commands sent on stdin, one per line
+*   \return FALSE once stdin is closed
+*/
+static uint8_t simIoReadControl(void)
+{
+    ssize_t len;
+    char c;
+    
+    while ((sim_control_head - __atomic_load_n(&sim_control_tail, __ATOMIC_ACQUIRE)) < SIM_CONTROL_RING_SIZE)
+    {
+        len = read(STDIN_FILENO, &c, 1);
+        if (len == 0)
+        {
+            return FALSE;
+        }
+        if (len < 0)
+        {
+            break;
+        }
+        if (c == '\n')
+        {
+            sim_control_line[sim_control_line_len] = 0;
+            strcpy(sim_control_ring[sim_control_head & SIM_CONTROL_RING_MASK], sim_control_line);
+            __atomic_store_n(&sim_control_head, sim_control_head + 1, __ATOMIC_RELEASE);
+            sim_control_line_len = 0;
+        }
+        else if (sim_control_line_len < SIM_CONTROL_LINE_LENGTH - 1)
+        {
+            sim_control_line[sim_control_line_len++] = c;
+        }
+    }
+    return TRUE;
+}
+
+/*! \fn     simIoThread(void* arg)
+*   \brief  I/O thread: stdin, stdout and USB host socket
+*   \param  arg     Unused
+*   \return Never returns
+*/
+static void* simIoThread(void* arg)
+{
+    struct pollfd pfds[3];
+    uint8_t stdin_open = TRUE;
+    uint64_t wake_count;
+    
+    (void)arg;
+    sim_is_io_thread = TRUE;
+    while (1)
+    {
+        simIoPrintLines();
+        
+        // Control commands are only read while the ring has room for them
+        pfds[0].fd = ((stdin_open != FALSE) && ((sim_control_head - __atomic_load_n(&sim_control_tail, __ATOMIC_ACQUIRE)) < SIM_CONTROL_RING_SIZE)) ? STDIN_FILENO : -1;
+        pfds[0].events = POLLIN;
+        pfds[1].fd = sim_wake_fd;
+        pfds[1].events = POLLIN;
+        simUsbIoPrepare(&pfds[2]);
+        if (poll(pfds, 3, -1) < 0)
+        {
+            continue;
+        }
+        
+        if ((pfds[0].fd >= 0) && (pfds[0].revents != 0))
+        {
+            stdin_open = simIoReadControl();
+        }
+        if (pfds[1].revents & POLLIN)
+        {
+            (void)!read(sim_wake_fd, &wake_count, sizeof(wake_count));
+        }
+        simUsbIoProcess(&pfds[2]);
+    }
+    return 0;
+}
+
+/*! \fn     simInit(void)
+*   \brief  Start the simulated peripherals before main() runs
+*/
+__attribute__((constructor)) static void simInit(void)
+{
+    const char* socket_path = getenv("MOOLTIPASS_SIM_SOCKET");
+    const char* tick_us = getenv("MOOLTIPASS_SIM_TICK_US");
+    sigset_t alarm_set, old_set;
+    struct itimerval timer;
+    struct sigaction sa;
+    long tick_period_us = SIM_DEFAULT_TICK_US;
+    
+    if ((tick_us != 0) && (atol(tick_us) > 0))
+    {
+        tick_period_us = atol(tick_us);
+    }
+    sim_tick_ns = tick_period_us * 1000;
+    
+    // Nothing pressed and no fault: all the inputs are pulled up
+    PINB = PINC = PIND = PINE = PINF = 0xFF;
+    
+    setvbuf(stdout, 0, _IONBF, 0);
+    simAt45Init();
+    
+    // Flash test mode: the flash test functions run against the DataFlash instead of the firmware
+    if (getenv("MOOLTIPASS_SIM_FLASH_TEST") != 0)
+    {
+        exit(simRunFlashTests());
+    }
+    
+    // Reports test mode: the socket reports FIFO is checked instead of running the firmware
+    if (getenv("MOOLTIPASS_SIM_REPORTS_TEST") != 0)
+    {
+        exit(simRunReportsTests());
+    }
+    
+    // Timer test mode: the timer manager is checked against a per tick countdown instead of running the firmware
+    if (getenv("MOOLTIPASS_SIM_TIMER_TEST") != 0)
+    {
+        exit(simRunTimerTests());
+    }
+    
+    fcntl(STDIN_FILENO, F_SETFL, fcntl(STDIN_FILENO, F_GETFL) | O_NONBLOCK);
+    simPcaInit(getenv("MOOLTIPASS_SIM_SLOW_SOCKETS"));
+    simUsbInit((socket_path != 0) ? socket_path : SIM_DEFAULT_SOCKET_PATH);
+    
+    // The tick signal is for the firmware thread only
+    sim_wake_fd = eventfd(0, EFD_NONBLOCK);
+    sigemptyset(&alarm_set);
+    sigaddset(&alarm_set, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &alarm_set, &old_set);
+    sim_io_thread_running = TRUE;
+    pthread_create(&sim_io_thread, 0, simIoThread, 0);
+    pthread_sigmask(SIG_SETMASK, &old_set, 0);
+    
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = simTickHandler;
+    sa.sa_flags = SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGALRM, &sa, 0);
+    clock_gettime(CLOCK_MONOTONIC, &sim_last_tick);
+    timer.it_interval.tv_sec = tick_period_us / 1000000;
+    timer.it_interval.tv_usec = tick_period_us % 1000000;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_REAL, &timer, 0);
+}
@@ -0,0 +1,104 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     sim_core.h
+*    \brief    Host simulator core: registers, interrupts and simulated tick
+*    Created:  17/10/2026
+*/
+
+
+#ifndef SIM_CORE_H_
+#define SIM_CORE_H_
+
+#include <stdint.h>
+
+// Prototypes
+void simSetInputPin(volatile uint8_t* pin_reg, uint8_t bitmask, uint8_t level);
+uint8_t simIsInInterrupt(void);
+void simPrintf(const char* fmt, ...);
+void simLog(const char* fmt, ...);
+void simEnterModel(void);
+void simLeaveModel(void);
+void simWakeIoThread(void);
+
+// Prototypes of the simulated peripherals, called by the core
+struct pollfd;
+void simPcaInit(const char* slow_sockets);
+void simPcaControl(char* command);
+void simI2cSyncLines(void);
+void simTwiTick(void);
+void simTwiRun(void);
+uint8_t simTwiPending(void);
+void simUsbInit(const char* socket_path);
+void simUsbTick(void);
+uint8_t simUsbGenPending(void);
+uint8_t simUsbComPending(void);
+void simUsbIoPrepare(struct pollfd* pfd);
+void simUsbIoProcess(struct pollfd* pfd);
+void simAt45Init(void);
+void simAt45Control(char* command);
+void simAt45ResetStats(void);
+uint64_t simAt45GetSpiBytes(void);
+uint64_t simAt45GetTimeUs(void);
+int simRunFlashTests(void);
+int simRunReportsTests(void);
+int simRunTimerTests(void);
+
+// Prototypes of the extenders, called by the I2C bus models
+void simI2cSlaveStart(uint8_t bus, uint16_t bus_khz);
+uint8_t simI2cSlaveWrite(uint8_t bus, uint8_t data);
+uint8_t simI2cSlaveRead(uint8_t bus);
+void simI2cSlaveStop(uint8_t bus);
+uint8_t simI2cSlaveHoldsSda(uint8_t bus);
+void simI2cSlaveClock(uint8_t bus);
+
+// Vectors defined by the firmware
+void TIMER1_COMPA_vect(void);
+void PCINT0_vect(void);
+void INT6_vect(void);
+void TWI_vect(void);
+void USB_GEN_vect(void);
+void USB_COM_vect(void);
+
+// Defines
+#define SIM_DEFAULT_SOCKET_PATH     "/tmp/mooltipass_sim.sock"      // Raw HID endpoint pair, override with MOOLTIPASS_SIM_SOCKET
+#define SIM_DEFAULT_TICK_US         1000                            // Simulated 1ms tick period, override with MOOLTIPASS_SIM_TICK_US
+#define SIM_CONTROL_LINE_LENGTH     64
+#define SIM_CONTROL_RING_SIZE       16                              // Control commands queued by the I/O thread, power of 2
+#define SIM_CONTROL_RING_MASK       (SIM_CONTROL_RING_SIZE-1)
+#define SIM_LOG_LINE_LENGTH         128
+#define SIM_LOG_NB_ARGS             4                               // Max number of simLog() arguments
+#define SIM_LOG_RING_SIZE           256                             // Lines queued for the I/O thread, power of 2
+#define SIM_LOG_RING_MASK           (SIM_LOG_RING_SIZE-1)
+
+// I2C buses
+#define SIM_I2C_HANG_CLOCKS         5                               // SCL pulses a hung extender needs to release SDA
+#define SIM_I2C_SLOW_KHZ            100                             // Max bus speed of the extenders listed in MOOLTIPASS_SIM_SLOW_SOCKETS
+
+// DataFlash busy times in us, AT45DB081E typical values
+#define SIM_AT45_TXFR_US            200                             // Main memory page to buffer transfer
+#define SIM_AT45_EP_US              15000                           // Page erase and program
+#define SIM_AT45_P_US               1500                            // Page program
+#define SIM_AT45_PE_US              12000                           // Page erase
+#define SIM_AT45_BE_US              30000                           // Block erase
+#define SIM_AT45_SE_US              700000                          // Sector erase
+#define SIM_AT45_CE_US              10000000                        // Chip erase
+#define SIM_AT45_SPI_BYTE_NS(ubrr)  (1000UL * ((ubrr) + 1))         // 8 clocks at Fosc / 2*(UBRR1 + 1)
+
+#endif /* SIM_CORE_H_ */
@@ -0,0 +1,188 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     sim_flash_test.c
+*    \brief    Host simulator: flash and node management tests on the DataFlash emulator
+*    Created:  17/10/2026
+*
+*    Run instead of the firmware when MOOLTIPASS_SIM_FLASH_TEST is set. Each
+*    test of flash_test.c, a read session check and a node management
+*    workload run on the AT45 emulator, one result line each:
+*    "flashtest <name> <PASSED|FAILED> bytes <spi bytes> us <simulated us>"
+*/
+#include <string.h>
+#include <stdio.h>
+#include "flash_test.h"
+#include "flash_mem.h"
+#include "node_mgmt.h"
+#include "sim_core.h"
+#include "defines.h"
+#include "spi.h"
+
+/* Number of services created by the node management workload */
+#define SIM_NODE_TEST_NB_SERVICES   64
+
+/*! \fn     simFlashReadStreamTest(uint8_t* bufferIn, uint8_t* bufferOut, uint16_t bufferSize)
+*   \brief  Read two pages back through a read session opened mid page, one byte then the rest
+*   \param  bufferIn    A bufferSize long buffer
+*   \param  bufferOut   A bufferSize long buffer
+*   \param  bufferSize  BYTES_PER_PAGE
+*   \return RETURN_OK if the session returns the same data as flashRawRead
+*/
+static RET_TYPE simFlashReadStreamTest(uint8_t* bufferIn, uint8_t* bufferOut, uint16_t bufferSize)
+{
+    for (uint16_t page = 1; page <= 2; page++)
+    {
+        for (uint16_t i = 0; i < bufferSize; i++)
+        {
+            bufferIn[i] = (uint8_t)(i * 7 + page);
+        }
+        writeDataToFlash(page, 0, bufferSize, bufferIn);
+    }
+    
+    flashRawRead(bufferIn, BYTES_PER_PAGE + bufferSize / 2, bufferSize);
+    flashReadStreamOpen(BYTES_PER_PAGE + bufferSize / 2);
+    bufferOut[0] = flashReadStreamGetByte();
+    flashReadStream(&bufferOut[1], bufferSize - 1);
+    flashReadStreamClose();
+    
+    return (memcmp(bufferIn, bufferOut, bufferSize) == 0) ? RETURN_OK : RETURN_READ_ERR;
+}
+
+/* Test taking the two page buffers */
+typedef RET_TYPE (*simFlashTest_t)(uint8_t* bufferIn, uint8_t* bufferOut, uint16_t bufferSize);
+typedef struct
+{
+    const char* name;
+    simFlashTest_t test;
+} simFlashTestEntry_t;
+
+static const simFlashTestEntry_t sim_flash_tests[] =
+{
+    {"write_read", flashWriteReadTest},
+    {"write_read_offset", flashWriteReadOffsetTest},
+    {"erase_page", flashErasePageTest},
+    {"erase_block", flashEraseBlockTest},
+    {"erase_sector_x", flashEraseSectorXTest},
+    {"erase_sector_0", flashEraseSectorZeroTest},
+    {"read_stream", simFlashReadStreamTest},
+};
+
+
+/*! \fn     simNodeManagementTest(void)
+*   \brief  Format the flash, create services in a shuffled order with one login each, walk them back
+*   \return RETURN_OK if the services are found sorted with their login
+*/
+static RET_TYPE simNodeManagementTest(void)
+{
+    char previous_service[sizeof(((pNode*)0)->service)] = "";
+    uint16_t nb_services = 0;
+    uint16_t parent_addr;
+    pNode parent;
+    cNode child;
+    
+    formatFlash();
+    formatUserProfileMemory(0);
+    initNodeManagementHandle(0);
+    
+    for (uint16_t i = 0; i < SIM_NODE_TEST_NB_SERVICES; i++)
+    {
+        memset(&parent, 0, sizeof(parent));
+        snprintf((char*)parent.service, sizeof(parent.service), "service%03u.com", (i * 37) % SIM_NODE_TEST_NB_SERVICES);
+        if (createParentNode(&parent, SERVICE_CRED_TYPE) != RETURN_OK)
+        {
+            return RETURN_WRITE_ERR;
+        }
+    }
+    
+    parent_addr = getStartingParentAddress();
+    while (parent_addr != NODE_ADDR_NULL)
+    {
+        readParentNode(&parent, parent_addr);
+        if (strcmp((char*)parent.service, previous_service) <= 0)
+        {
+            return RETURN_NO_MATCH;
+        }
+        strcpy(previous_service, (char*)parent.service);
+        
+        memset(&child, 0, sizeof(child));
+        snprintf((char*)child.login, sizeof(child.login), "login@%.40s", (char*)parent.service);
+        if (createChildNode(parent_addr, &child) != RETURN_OK)
+        {
+            return RETURN_WRITE_ERR;
+        }
+        
+        readParentNode(&parent, parent_addr);
+        readChildNode(&child, parent.nextChildAddress);
+        if ((strncmp((char*)child.login, "login@", 6) != 0) || (strcmp((char*)child.login + 6, (char*)parent.service) != 0))
+        {
+            return RETURN_READ_ERR;
+        }
+        parent_addr = parent.nextParentAddress;
+        nb_services++;
+    }
+    
+    return (nb_services == SIM_NODE_TEST_NB_SERVICES) ? RETURN_OK : RETURN_NO_MATCH;
+}
+
+/*! \fn     simPrintFlashTestResult(const char* name, RET_TYPE ret)
+*   \brief  Print a test result with the SPI bytes and simulated time it took
+*   \param  name    The test name
+*   \param  ret     The test return value
+*/
+static void simPrintFlashTestResult(const char* name, RET_TYPE ret)
+{
+    simPrintf("flashtest %s %s bytes %llu us %llu\n", name, (ret == RETURN_OK) ? "PASSED" : "FAILED", (unsigned long long)simAt45GetSpiBytes(), (unsigned long long)simAt45GetTimeUs());
+}
+
+/*! \fn     simRunFlashTests(void)
+*   \brief  Run all the flash tests, stopping at the first failure
+*   \return The process exit status: 0 if they all passed
+*/
+int simRunFlashTests(void)
+{
+    uint8_t inputBuffer[BYTES_PER_PAGE];
+    uint8_t outputBuffer[BYTES_PER_PAGE];
+    RET_TYPE ret;
+    
+    spiUsartBegin();
+    simAt45ResetStats();
+    ret = flashInitTest();
+    simPrintFlashTestResult("init", ret);
+    if (ret != RETURN_OK)
+    {
+        return 1;
+    }
+    
+    for (uint8_t i = 0; i < sizeof(sim_flash_tests)/sizeof(sim_flash_tests[0]); i++)
+    {
+        simAt45ResetStats();
+        ret = sim_flash_tests[i].test(inputBuffer, outputBuffer, BYTES_PER_PAGE);
+        simPrintFlashTestResult(sim_flash_tests[i].name, ret);
+        if (ret != RETURN_OK)
+        {
+            return 1;
+        }
+    }
+    
+    simAt45ResetStats();
+    ret = simNodeManagementTest();
+    simPrintFlashTestResult("node_mgmt", ret);
+    return (ret == RETURN_OK) ? 0 : 1;
+}
@@ -0,0 +1,389 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     sim_i2c_bus.c
+*    \brief    Host simulator: TWI controller and I2C lines
+*    Created:  17/10/2026
+*
+*    TWI controller: TWCR, TWDR, TWSR and TWBR are plain variables, a TWCR
+*    write having TWINT set is a command. On each tick the controller runs
+*    the commands written since, for up to a tick of bus time at the TWBR bit
+*    rate. Completing a start, address or data phase sets TWSR and raises the
+*    TWI interrupt, whose vector writes the next command. A plain variable
+*    can't both read back TWINT set and see it written to one, so the
+*    controller clears TWINT when it takes a command and keeps the interrupt
+*    flag on its side, i2c.c doesn't poll it.
+*
+*    I2C lines: the I2C IO defines reach ports B and D through
+*    simI2cLineReg() (see defines.h), which evaluates the open drain SCL / SDA
+*    levels from the DDR and PORT bits written since the previous access,
+*    then updates the PIN bits. The bit banged bus is decoded into start and
+*    stop conditions and bytes for the extenders. The TWI bus lines only
+*    matter while the controller is off: SCL pulses then free a hung extender
+*    and SDA rising while SCL is high ends the transfer.
+*/
+#include <avr/io.h>
+#include "prog_rig_sockets.h"
+#include "sim_core.h"
+#include "defines.h"
+#include "i2c.h"
+
+/* Controller state */
+#define SIM_TWI_IDLE        0           // Bus not owned
+#define SIM_TWI_ADDRESS     1           // (Repeated) start sent, address to send
+#define SIM_TWI_MT          2           // Master transmitter
+#define SIM_TWI_MR          3           // Master receiver
+#define SIM_TWI_NACKED      4           // Bus owned, waiting for a stop or a start
+#define SIM_TWI_BYTE_BITS   9           // 8 data bits and the acknowledge bit
+
+/* Bit banged bus transfer direction */
+#define SIM_SOFT_MASTER_TX  0
+#define SIM_SOFT_SLAVE_TX   1
+
+/* Lines on the ports */
+#define SIM_TWI_SCL_MASK    (1 << PORTID_I2C_SCL)
+#define SIM_TWI_SDA_MASK    (1 << PORTID_I2C_SDA)
+#define SIM_SOFT_SCL_MASK   (1 << PORTID_SOFT_I2C_SCL)
+#define SIM_SOFT_SDA_MASK   (1 << PORTID_SOFT_I2C_SDA)
+
+/* TWI controller */
+static uint8_t sim_twi_state = SIM_TWI_IDLE;
+static uint8_t sim_twi_flag = FALSE;
+static long sim_twi_budget_ns;
+/* TWI bus lines, while the controller is off */
+static uint8_t sim_twi_scl = TRUE;
+static uint8_t sim_twi_sda = TRUE;
+/* Bit banged bus: line levels, transfer in progress */
+static uint8_t sim_soft_scl = TRUE;
+static uint8_t sim_soft_sda = TRUE;
+static uint8_t sim_soft_started = FALSE;
+static uint8_t sim_soft_mode;
+static uint8_t sim_soft_nb_rises;           // SCL rising edges in the current byte
+static uint8_t sim_soft_nb_bytes;           // Bytes since the start condition
+static uint8_t sim_soft_byte;
+static uint8_t sim_soft_slave_sda_low;      // Extender driving SDA low
+static uint8_t sim_soft_read_addressed;     // Address byte acknowledged in read mode
+
+
+/*! \fn     simTwiBitNs(void)
+*   \brief  SCL period set by TWBR and the TWSR prescaler
+*   \return The period in ns
+*/
+static long simTwiBitNs(void)
+{
+    return (16L + 2L * TWBR * (1L << (2 * (TWSR & 0x03)))) * 1000L / 16L;
+}
+
+/*! \fn     simTwiComplete(uint8_t status)
+*   \brief  End of an operation: set the status and raise the TWI interrupt flag
+*   \param  status  The TWSR status code
+*/
+static void simTwiComplete(uint8_t status)
+{
+    TWSR = (TWSR & 0x03) | status;
+    sim_twi_flag = TRUE;
+}
+
+/*! \fn     simTwiRun(void)
+*   \brief  Run the TWCR commands written since the last operation, within the bus time budget
+*/
+void simTwiRun(void)
+{
+    uint8_t held, twcr, ack;
+    long bit_ns = simTwiBitNs();
+    
+    // Writing TWINT to one clears the flag and starts the next operation
+    while ((twcr = TWCR) & (1 << TWINT))
+    {
+        sim_twi_flag = FALSE;
+        held = simI2cSlaveHoldsSda(PROG_RIG_BUS_TWI);
+        if ((twcr & (1 << TWEN)) == 0)
+        {
+            // Disabled controller: the command is ignored
+            sim_twi_state = SIM_TWI_IDLE;
+            TWCR = twcr & ~(1 << TWINT);
+            continue;
+        }
+        
+        if (twcr & (1 << TWSTO))
+        {
+            // The controller doesn't wait for the stop condition, a held SDA line makes it void
+            if ((sim_twi_state != SIM_TWI_IDLE) && (held == FALSE))
+            {
+                simI2cSlaveStop(PROG_RIG_BUS_TWI);
+            }
+            sim_twi_state = SIM_TWI_IDLE;
+            twcr &= ~(1 << TWSTO);
+            TWCR = (twcr & (1 << TWSTA)) ? twcr : (twcr & ~(1 << TWINT));
+            continue;
+        }
+        
+        if (twcr & (1 << TWSTA))
+        {
+            // The start condition waits for the bus to be free
+            if ((held != FALSE) || (sim_twi_budget_ns < bit_ns))
+            {
+                return;
+            }
+            sim_twi_budget_ns -= bit_ns;
+            TWCR = twcr & ~(1 << TWINT);
+            simTwiComplete((sim_twi_state == SIM_TWI_IDLE) ? I2C_START : I2C_RSTART);
+            sim_twi_state = SIM_TWI_ADDRESS;
+            simI2cSlaveStart(PROG_RIG_BUS_TWI, (uint16_t)(1000000L / bit_ns));
+            continue;
+        }
+        
+        if (sim_twi_budget_ns < SIM_TWI_BYTE_BITS * bit_ns)
+        {
+            return;
+        }
+        sim_twi_budget_ns -= SIM_TWI_BYTE_BITS * bit_ns;
+        TWCR = twcr & ~(1 << TWINT);
+        switch (sim_twi_state)
+        {
+            case SIM_TWI_ADDRESS:
+            {
+                ack = simI2cSlaveWrite(PROG_RIG_BUS_TWI, TWDR);
+                if (TWDR & 0x01)
+                {
+                    simTwiComplete((ack != FALSE) ? I2C_SLAR_ACK : I2C_SLAR_NACK);
+                    sim_twi_state = (ack != FALSE) ? SIM_TWI_MR : SIM_TWI_NACKED;
+                }
+                else
+                {
+                    simTwiComplete((ack != FALSE) ? I2C_SLA_ACK : I2C_SLA_NACK);
+                    sim_twi_state = (ack != FALSE) ? SIM_TWI_MT : SIM_TWI_NACKED;
+                }
+                break;
+            }
+            case SIM_TWI_MT:
+            {
+                if ((held != FALSE) && (TWDR != 0x00))
+                {
+                    // The held SDA line doesn't follow our first recessive bit
+                    simTwiComplete(I2C_ARB_ERROR);
+                    sim_twi_state = SIM_TWI_IDLE;
+                }
+                else
+                {
+                    ack = (held != FALSE) ? TRUE : simI2cSlaveWrite(PROG_RIG_BUS_TWI, TWDR);
+                    simTwiComplete((ack != FALSE) ? I2C_DATA_ACK : I2C_DATA_NACK);
+                }
+                break;
+            }
+            case SIM_TWI_MR:
+            {
+                TWDR = (held != FALSE) ? 0x00 : simI2cSlaveRead(PROG_RIG_BUS_TWI);
+                simTwiComplete((twcr & (1 << TWEA)) ? I2C_DATAR_ACK : I2C_DATAR_NACK);
+                break;
+            }
+            default:
+            {
+                // No transfer to clock a byte into
+                break;
+            }
+        }
+    }
+}
+
+/*! \fn     simTwiTick(void)
+*   \brief  Give the controller a tick of bus time and run the pending commands
+*/
+void simTwiTick(void)
+{
+    sim_twi_budget_ns += 1000000L;
+    if (sim_twi_budget_ns > 1000000L)
+    {
+        sim_twi_budget_ns = 1000000L;
+    }
+    simTwiRun();
+}
+
+/*! \fn     simTwiPending(void)
+*   \brief  Know if the TWI vector is to be run
+*   \return TRUE or FALSE
+*/
+uint8_t simTwiPending(void)
+{
+    // Writing TWINT to one clears the flag, simTwiRun() takes the command
+    if (TWCR & (1 << TWINT))
+    {
+        sim_twi_flag = FALSE;
+    }
+    return ((sim_twi_flag != FALSE) && (TWCR & (1 << TWIE))) ? TRUE : FALSE;
+}
+
+/*! \fn     simLineLevel(uint8_t ddr, uint8_t port, uint8_t mask)
+*   \brief  Level of a line the MCU drives open drain
+*   \param  ddr     The DDR register value
+*   \param  port    The PORT register value
+*   \param  mask    The pin mask
+*   \return FALSE if the pin pulls the line low, TRUE if the line is released
+*/
+static uint8_t simLineLevel(uint8_t ddr, uint8_t port, uint8_t mask)
+{
+    return ((ddr & mask) && !(port & mask)) ? FALSE : TRUE;
+}
+
+/*! \fn     simTwiSyncLines(void)
+*   \brief  TWI bus lines: controller off, watch the pulses freeing a hung extender and the stop condition
+*/
+static void simTwiSyncLines(void)
+{
+    uint8_t scl = TRUE;
+    uint8_t sda = (simI2cSlaveHoldsSda(PROG_RIG_BUS_TWI) != FALSE) ? FALSE : TRUE;
+    
+    if ((TWCR & (1 << TWEN)) == 0)
+    {
+        sim_twi_state = SIM_TWI_IDLE;
+        scl = simLineLevel(DDRD, PORTD, SIM_TWI_SCL_MASK);
+        if ((scl != FALSE) && (sim_twi_scl == FALSE))
+        {
+            simI2cSlaveClock(PROG_RIG_BUS_TWI);
+            sda = (simI2cSlaveHoldsSda(PROG_RIG_BUS_TWI) != FALSE) ? FALSE : TRUE;
+        }
+        sda = sda && simLineLevel(DDRD, PORTD, SIM_TWI_SDA_MASK);
+        if ((scl != FALSE) && (sim_twi_scl != FALSE) && (sda != FALSE) && (sim_twi_sda == FALSE))
+        {
+            simI2cSlaveStop(PROG_RIG_BUS_TWI);
+        }
+    }
+    sim_twi_scl = scl;
+    sim_twi_sda = sda;
+    PIND = (PIND & ~(SIM_TWI_SCL_MASK | SIM_TWI_SDA_MASK)) | (scl ? SIM_TWI_SCL_MASK : 0) | (sda ? SIM_TWI_SDA_MASK : 0);
+}
+
+/*! \fn     simSoftSclFalling(void)
+*   \brief  Bit banged bus: SCL falling edge, the extender sets up its acknowledge or its next data bit
+*/
+static void simSoftSclFalling(void)
+{
+    uint8_t ack;
+    
+    if (sim_soft_nb_rises == 8)
+    {
+        if (sim_soft_mode == SIM_SOFT_MASTER_TX)
+        {
+            ack = simI2cSlaveWrite(PROG_RIG_BUS_SOFT, sim_soft_byte);
+            if (sim_soft_nb_bytes == 0)
+            {
+                sim_soft_read_addressed = ((ack != FALSE) && (sim_soft_byte & 0x01)) ? TRUE : FALSE;
+            }
+            sim_soft_slave_sda_low = ack;
+        }
+        else
+        {
+            // Acknowledge bit is the master's
+            sim_soft_slave_sda_low = FALSE;
+        }
+    }
+    else if (sim_soft_nb_rises == 9)
+    {
+        // End of the acknowledge bit: next byte
+        sim_soft_nb_rises = 0;
+        sim_soft_nb_bytes++;
+        sim_soft_byte = 0;
+        sim_soft_slave_sda_low = FALSE;
+        if (sim_soft_read_addressed != FALSE)
+        {
+            sim_soft_read_addressed = FALSE;
+            sim_soft_mode = SIM_SOFT_SLAVE_TX;
+            sim_soft_byte = simI2cSlaveRead(PROG_RIG_BUS_SOFT);
+            sim_soft_slave_sda_low = (sim_soft_byte & 0x80) ? FALSE : TRUE;
+        }
+        else
+        {
+            sim_soft_mode = SIM_SOFT_MASTER_TX;
+        }
+    }
+    else if ((sim_soft_mode == SIM_SOFT_SLAVE_TX) && (sim_soft_nb_rises != 0))
+    {
+        sim_soft_slave_sda_low = (sim_soft_byte & (0x80 >> sim_soft_nb_rises)) ? FALSE : TRUE;
+    }
+}
+
+/*! \fn     simSoftSyncLines(void)
+*   \brief  Bit banged bus lines: decode the edges since the previous access
+*/
+static void simSoftSyncLines(void)
+{
+    uint8_t master_sda = simLineLevel(DDRB, PORTB, SIM_SOFT_SDA_MASK);
+    uint8_t scl = simLineLevel(DDRB, PORTB, SIM_SOFT_SCL_MASK);
+    uint8_t sda = master_sda && !sim_soft_slave_sda_low;
+    
+    if ((scl != FALSE) && (sim_soft_scl != FALSE) && (sda != sim_soft_sda))
+    {
+        // SDA changing while SCL is high: start or stop condition
+        if (sda == FALSE)
+        {
+            simI2cSlaveStart(PROG_RIG_BUS_SOFT, SIM_I2C_SLOW_KHZ);
+            sim_soft_started = TRUE;
+            sim_soft_mode = SIM_SOFT_MASTER_TX;
+            sim_soft_nb_rises = 0;
+            sim_soft_nb_bytes = 0;
+            sim_soft_byte = 0;
+            sim_soft_read_addressed = FALSE;
+        }
+        else
+        {
+            simI2cSlaveStop(PROG_RIG_BUS_SOFT);
+            sim_soft_started = FALSE;
+        }
+    }
+    else if ((scl != FALSE) && (sim_soft_scl == FALSE) && (sim_soft_started != FALSE))
+    {
+        // Rising edge: data set up before it, sampled
+        if ((sim_soft_nb_rises < 8) && (sim_soft_mode == SIM_SOFT_MASTER_TX))
+        {
+            sim_soft_byte = (sim_soft_byte << 1) | (sda ? 0x01 : 0x00);
+        }
+        sim_soft_nb_rises++;
+    }
+    else if ((scl == FALSE) && (sim_soft_scl != FALSE) && (sim_soft_started != FALSE))
+    {
+        // Falling edge: the extender changes SDA after it
+        simSoftSclFalling();
+        sda = master_sda && !sim_soft_slave_sda_low;
+    }
+    sim_soft_scl = scl;
+    sim_soft_sda = sda;
+    PINB = (PINB & ~(SIM_SOFT_SCL_MASK | SIM_SOFT_SDA_MASK)) | (scl ? SIM_SOFT_SCL_MASK : 0) | (sda ? SIM_SOFT_SDA_MASK : 0);
+}
+
+/*! \fn     simI2cSyncLines(void)
+*   \brief  Evaluate the I2C lines from the port registers
+*/
+void simI2cSyncLines(void)
+{
+    simEnterModel();
+    simTwiSyncLines();
+    simSoftSyncLines();
+    simLeaveModel();
+}
+
+/*! \fn     simI2cLineReg(volatile uint8_t* reg)
+*   \brief  I2C lines ports: the write of the previous access is seen before the register is returned
+*   \param  reg     The PORTx, DDRx or PINx register
+*   \return The register
+*/
+volatile uint8_t* simI2cLineReg(volatile uint8_t* reg)
+{
+    simI2cSyncLines();
+    return reg;
+}
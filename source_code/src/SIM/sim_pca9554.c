@@ -0,0 +1,378 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     sim_pca9554.c
+*    \brief    Host simulator: virtual PCA9554 extenders behind the I2C buses
+*    Created:  17/10/2026
+*
+*    One virtual extender is created for each entry of prog_rig_sockets[],
+*    on its bus and at its address. The bus models of sim_i2c_bus.c hand
+*    them the bytes they clock: the first one after a start condition is the
+*    address, then comes the command byte, which the extender keeps between
+*    transactions, then the register data. An extender asserts its INT
+*    output while one of its inputs differs from the value of the last input
+*    port read, the shared interrupt lines are driven on the PINx registers
+*    socket_events.c samples.
+*
+*    Control commands, one per line on stdin:
+*    press <socket>, release <socket>: push / release the socket button
+*    short <socket>, unshort <socket>: assert / clear the socket 5v fault
+*    nack <socket>: NACK the next register data written to the socket extender
+*    hang <socket>: the socket extender holds SDA low after its next address
+*    byte, until SCL is pulsed SIM_I2C_HANG_CLOCKS times (TWI bus only)
+*    The extenders listed in MOOLTIPASS_SIM_SLOW_SOCKETS (comma separated
+*    socket IDs) don't answer above SIM_I2C_SLOW_KHZ.
+*    Output register changes are printed as "socket <id> output 0x<val>".
+*/
+#include <stdlib.h>
+#include <string.h>
+#include "prog_rig_sockets.h"
+#include "sim_core.h"
+#include "defines.h"
+
+/* PCA9554 registers & socket pins */
+#define PCA_REG_INPUT       0
+#define PCA_REG_OUTPUT      1
+#define PCA_REG_POLARITY    2
+#define PCA_REG_CONFIG      3
+#define PCA_PIN_SWITCH      0x08
+#define PCA_PIN_PSU_FAULT   0x80
+#define SIM_NB_I2C_BUSES    2
+#define SIM_NB_I2C_ADDRS    128
+
+/* Virtual extender */
+typedef struct
+{
+    uint8_t present;
+    uint8_t socket_id;
+    uint8_t pins;               // Levels applied on the pins configured as inputs
+    uint8_t last_read;          // Pin levels at the last input port read
+    uint8_t nb_nacks;           // Number of register writes to NACK
+    uint8_t hang;               // Hold SDA after the next address byte
+    uint8_t slow;               // Doesn't answer above SIM_I2C_SLOW_KHZ
+    uint8_t command;            // Command byte: register pointer
+    uint8_t regs[4];
+} simPca9554_t;
+
+/* Transfer in progress on a bus */
+typedef struct
+{
+    simPca9554_t* pca;          // Addressed extender, 0 if none
+    uint8_t nb_bytes;           // Bytes clocked since the start condition
+    uint8_t reading;            // Addressed in read mode
+    uint16_t bus_khz;           // Bus speed since the start condition
+    uint8_t hold_sda;           // A hung extender holds SDA low
+    uint8_t hold_socket_id;     // Socket of that extender
+    uint8_t hold_clocks;        // SCL pulses clocked since
+} simI2cTransfer_t;
+
+/* Extenders, by bus and 7 bits address */
+static simPca9554_t sim_pcas[SIM_NB_I2C_BUSES][SIM_NB_I2C_ADDRS];
+static simI2cTransfer_t sim_i2c_transfers[SIM_NB_I2C_BUSES];
+/* Pins of the interrupt lines, same order as socket_events.c */
+static volatile uint8_t* const sim_int_pin_regs[NB_PROG_RIG_INT_LINES] = {&PINF, &PINC, &PINC, &PINB, &PINB, &PINB, &PINB, &PINB};
+static const uint8_t sim_int_pin_masks[NB_PROG_RIG_INT_LINES] = {1 << 7, 1 << 7, 1 << 6, 1 << 2, 1 << 3, 1 << 7, 1 << 6, 1 << 5};
+
+
+/*! \fn     simGetPca(uint8_t bus, uint8_t addr)
+*   \brief  Get the extender answering on a bus at a given address
+*   \param  bus     PROG_RIG_BUS_TWI or PROG_RIG_BUS_SOFT
+*   \param  addr    The 8 bits address
+*   \return The extender, 0 if nothing answers
+*/
+static simPca9554_t* simGetPca(uint8_t bus, uint8_t addr)
+{
+    simPca9554_t* pca = &sim_pcas[bus][(addr >> 1) & (SIM_NB_I2C_ADDRS-1)];
+    
+    return (pca->present != FALSE) ? pca : 0;
+}
+
+/*! \fn     simGetPcaPinLevels(simPca9554_t* pca)
+*   \brief  Pin levels: applied levels for the inputs, output register for the outputs
+*   \param  pca     The extender
+*   \return The pin levels
+*/
+static uint8_t simGetPcaPinLevels(simPca9554_t* pca)
+{
+    return (pca->pins & pca->regs[PCA_REG_CONFIG]) | (pca->regs[PCA_REG_OUTPUT] & ~pca->regs[PCA_REG_CONFIG]);
+}
+
+/*! \fn     simUpdateInterruptLines(void)
+*   \brief  Drive the shared interrupt lines from the extenders INT outputs
+*/
+static void simUpdateInterruptLines(void)
+{
+    uint8_t asserted_lines = 0;
+    
+    for (uint8_t i = 0; i < NB_EXPANDER_SOCKETS; i++)
+    {
+        simPca9554_t* pca = simGetPca(prog_rig_sockets[i].bus, prog_rig_sockets[i].addr);
+        
+        if (((simGetPcaPinLevels(pca) ^ pca->last_read) & pca->regs[PCA_REG_CONFIG]) != 0)
+        {
+            asserted_lines |= (1 << prog_rig_sockets[i].int_line);
+        }
+    }
+    for (uint8_t i = 0; i < NB_PROG_RIG_INT_LINES; i++)
+    {
+        simSetInputPin(sim_int_pin_regs[i], sim_int_pin_masks[i], (asserted_lines & (1 << i)) == 0);
+    }
+}
+
+/*! \fn     simI2cSlaveStart(uint8_t bus, uint16_t bus_khz)
+*   \brief  (Repeated) start condition on a bus
+*   \param  bus     PROG_RIG_BUS_TWI or PROG_RIG_BUS_SOFT
+*   \param  bus_khz The SCL frequency
+*/
+void simI2cSlaveStart(uint8_t bus, uint16_t bus_khz)
+{
+    simI2cTransfer_t* transfer = &sim_i2c_transfers[bus];
+    
+    transfer->pca = 0;
+    transfer->nb_bytes = 0;
+    transfer->bus_khz = bus_khz;
+}
+
+/*! \fn     simI2cSlaveStop(uint8_t bus)
+*   \brief  Stop condition on a bus
+*   \param  bus     PROG_RIG_BUS_TWI or PROG_RIG_BUS_SOFT
+*/
+void simI2cSlaveStop(uint8_t bus)
+{
+    sim_i2c_transfers[bus].pca = 0;
+    sim_i2c_transfers[bus].nb_bytes = 0;
+}
+
+/*! \fn     simI2cSlaveWrite(uint8_t bus, uint8_t data)
+*   \brief  Byte clocked by the master
+*   \param  bus     PROG_RIG_BUS_TWI or PROG_RIG_BUS_SOFT
+*   \param  data    The byte
+*   \return TRUE if an extender acknowledged it
+*/
+uint8_t simI2cSlaveWrite(uint8_t bus, uint8_t data)
+{
+    simI2cTransfer_t* transfer = &sim_i2c_transfers[bus];
+    simPca9554_t* pca;
+    
+    // Address byte
+    if (transfer->nb_bytes++ == 0)
+    {
+        pca = simGetPca(bus, data);
+        if ((pca == 0) || ((pca->slow != FALSE) && (transfer->bus_khz > SIM_I2C_SLOW_KHZ)))
+        {
+            return FALSE;
+        }
+        transfer->pca = pca;
+        transfer->reading = data & 0x01;
+        if (pca->hang != FALSE)
+        {
+            pca->hang = FALSE;
+            transfer->hold_sda = TRUE;
+            transfer->hold_socket_id = pca->socket_id;
+            transfer->hold_clocks = 0;
+            simLog("socket %llu holding sda\n", (unsigned long long)pca->socket_id);
+        }
+        return TRUE;
+    }
+    
+    pca = transfer->pca;
+    if ((pca == 0) || (transfer->reading != FALSE))
+    {
+        return FALSE;
+    }
+    
+    // Command byte, then register data
+    if (transfer->nb_bytes == 2)
+    {
+        pca->command = data & 0x03;
+        return TRUE;
+    }
+    if (pca->nb_nacks != 0)
+    {
+        pca->nb_nacks--;
+        simLog("socket %llu write nacked\n", (unsigned long long)pca->socket_id);
+        return FALSE;
+    }
+    if (pca->command == PCA_REG_INPUT)
+    {
+        return TRUE;
+    }
+    if ((pca->command == PCA_REG_OUTPUT) && (pca->regs[PCA_REG_OUTPUT] != data))
+    {
+        simLog("socket %llu output 0x%02llx\n", (unsigned long long)pca->socket_id, (unsigned long long)data);
+    }
+    pca->regs[pca->command] = data;
+    simUpdateInterruptLines();
+    return TRUE;
+}
+
+/*! \fn     simI2cSlaveRead(uint8_t bus)
+*   \brief  Byte clocked out by the addressed extender
+*   \param  bus     PROG_RIG_BUS_TWI or PROG_RIG_BUS_SOFT
+*   \return The byte, 0xFF (released SDA) if nothing is addressed in read mode
+*/
+uint8_t simI2cSlaveRead(uint8_t bus)
+{
+    simI2cTransfer_t* transfer = &sim_i2c_transfers[bus];
+    simPca9554_t* pca = transfer->pca;
+    uint8_t data;
+    
+    if ((pca == 0) || (transfer->reading == FALSE))
+    {
+        return 0xFF;
+    }
+    transfer->nb_bytes++;
+    if (pca->command == PCA_REG_INPUT)
+    {
+        // Reading the input port clears the interrupt
+        pca->last_read = simGetPcaPinLevels(pca);
+        data = pca->last_read ^ pca->regs[PCA_REG_POLARITY];
+        simUpdateInterruptLines();
+    }
+    else
+    {
+        data = pca->regs[pca->command];
+    }
+    return data;
+}
+
+/*! \fn     simI2cSlaveHoldsSda(uint8_t bus)
+*   \brief  Know if a hung extender holds SDA low
+*   \param  bus     PROG_RIG_BUS_TWI or PROG_RIG_BUS_SOFT
+*   \return TRUE or FALSE
+*/
+uint8_t simI2cSlaveHoldsSda(uint8_t bus)
+{
+    return sim_i2c_transfers[bus].hold_sda;
+}
+
+/*! \fn     simI2cSlaveClock(uint8_t bus)
+*   \brief  SCL pulse generated while the controller is off (bus recovery)
+*   \param  bus     PROG_RIG_BUS_TWI or PROG_RIG_BUS_SOFT
+*/
+void simI2cSlaveClock(uint8_t bus)
+{
+    simI2cTransfer_t* transfer = &sim_i2c_transfers[bus];
+    
+    if ((transfer->hold_sda != FALSE) && (++transfer->hold_clocks >= SIM_I2C_HANG_CLOCKS))
+    {
+        // The extender finished clocking out the byte it was stuck in
+        transfer->hold_sda = FALSE;
+        simLog("socket %llu released sda after %llu clocks\n", (unsigned long long)transfer->hold_socket_id, (unsigned long long)transfer->hold_clocks);
+        simI2cSlaveStop(bus);
+    }
+}
+
+/*! \fn     simSetSocketPin(uint8_t socket_id, uint8_t pca_pin, uint8_t level)
+*   \brief  Drive a socket input
+*   \param  socket_id   The socket ID
+*   \param  pca_pin     PCA_PIN_SWITCH or PCA_PIN_PSU_FAULT
+*   \param  level       0 for low, any other value for high
+*/
+static void simSetSocketPin(uint8_t socket_id, uint8_t pca_pin, uint8_t level)
+{
+    if (socket_id == DIRECT_SOCKET_ID)
+    {
+        // Button on PE6, 5v fault on PF6
+        simSetInputPin((pca_pin == PCA_PIN_SWITCH) ? &PINE : &PINF, 0x40, level);
+    }
+    else if (socket_id < NB_EXPANDER_SOCKETS)
+    {
+        simPca9554_t* pca = simGetPca(prog_rig_sockets[socket_id].bus, prog_rig_sockets[socket_id].addr);
+        pca->pins = level ? (pca->pins | pca_pin) : (pca->pins & ~pca_pin);
+        simUpdateInterruptLines();
+    }
+}
+
+/*! \fn     simPcaControl(char* command)
+*   \brief  Run a control command
+*   \param  command     The command line
+*/
+void simPcaControl(char* command)
+{
+    char* arg = strchr(command, ' ');
+    uint8_t socket_id;
+    
+    if (arg == 0)
+    {
+        return;
+    }
+    *arg++ = 0;
+    socket_id = (uint8_t)atoi(arg);
+    
+    if (strcmp(command, "press") == 0)
+    {
+        simSetSocketPin(socket_id, PCA_PIN_SWITCH, 0);
+    }
+    else if (strcmp(command, "release") == 0)
+    {
+        simSetSocketPin(socket_id, PCA_PIN_SWITCH, 1);
+    }
+    else if (strcmp(command, "short") == 0)
+    {
+        simSetSocketPin(socket_id, PCA_PIN_PSU_FAULT, 0);
+    }
+    else if (strcmp(command, "unshort") == 0)
+    {
+        simSetSocketPin(socket_id, PCA_PIN_PSU_FAULT, 1);
+    }
+    else if ((strcmp(command, "nack") == 0) && (socket_id < NB_EXPANDER_SOCKETS))
+    {
+        simGetPca(prog_rig_sockets[socket_id].bus, prog_rig_sockets[socket_id].addr)->nb_nacks++;
+    }
+    else if ((strcmp(command, "hang") == 0) && (socket_id < NB_EXPANDER_SOCKETS) && (prog_rig_sockets[socket_id].bus == PROG_RIG_BUS_TWI))
+    {
+        simGetPca(prog_rig_sockets[socket_id].bus, prog_rig_sockets[socket_id].addr)->hang = TRUE;
+    }
+}
+
+/*! \fn     simPcaInit(const char* slow_sockets)
+*   \brief  Create the virtual extenders, at their power on state
+*   \param  slow_sockets    Comma separated IDs of the sockets whose extender is slow, may be 0
+*/
+void simPcaInit(const char* slow_sockets)
+{
+    for (uint8_t i = 0; i < NB_EXPANDER_SOCKETS; i++)
+    {
+        simPca9554_t* pca = &sim_pcas[prog_rig_sockets[i].bus][(prog_rig_sockets[i].addr >> 1) & (SIM_NB_I2C_ADDRS-1)];
+        
+        pca->present = TRUE;
+        pca->socket_id = i;
+        pca->pins = 0xFF;
+        pca->last_read = 0xFF;
+        pca->regs[PCA_REG_OUTPUT] = 0xFF;
+        pca->regs[PCA_REG_POLARITY] = 0x00;
+        pca->regs[PCA_REG_CONFIG] = 0xFF;
+    }
+    
+    while ((slow_sockets != 0) && (*slow_sockets != 0))
+    {
+        uint8_t socket_id = (uint8_t)atoi(slow_sockets);
+        
+        if (socket_id < NB_EXPANDER_SOCKETS)
+        {
+            simGetPca(prog_rig_sockets[socket_id].bus, prog_rig_sockets[socket_id].addr)->slow = TRUE;
+        }
+        slow_sockets = strchr(slow_sockets, ',');
+        if (slow_sockets != 0)
+        {
+            slow_sockets++;
+        }
+    }
+}
@@ -0,0 +1,103 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     sim_platform.c
+*    \brief    Host simulator: display, random number generator and eeprom parameters
+*    Created:  17/10/2026
+*
+*    The display lines are printed as "display <y> <text>" and the random
+*    bytes come from rand(). The media flash is emulated in sim_at45.c.
+*/
+#include <stdlib.h>
+#include "logic_eeprom.h"
+#include "oledmini.h"
+#include "sim_core.h"
+#include "defines.h"
+#include "rng.h"
+
+
+void miniOledInitIOs(void)
+{
+}
+
+void miniOledBegin(uint8_t font)
+{
+    (void)font;
+}
+
+void miniOledFlushWrittenTextToDisplay(void)
+{
+}
+
+uint8_t miniOledPutstrXY(uint8_t x, uint8_t y, uint8_t justify, const char* str)
+{
+    (void)x;
+    (void)justify;
+    simPrintf("display %u %s\n", y, str);
+    return 0;
+}
+
+void miniOledBitmapDrawFlash(int8_t x, int8_t y, uint8_t fileId, uint8_t options)
+{
+    (void)x;
+    (void)y;
+    (void)fileId;
+    (void)options;
+}
+
+void miniOledDrawRectangle(uint8_t x, uint8_t y, uint8_t width, uint8_t height, uint8_t full)
+{
+    (void)x;
+    (void)y;
+    (void)width;
+    (void)height;
+    (void)full;
+}
+
+void rngInit(void)
+{
+}
+
+uint8_t rngGetBufferCount(void)
+{
+    return 0xFF / 4;
+}
+
+void fillArrayWithRandomBytes(uint8_t* buffer, uint8_t nb_bytes)
+{
+    while (nb_bytes--)
+    {
+        *buffer++ = (uint8_t)rand();
+    }
+}
+
+uint8_t getMooltipassParameterInEeprom(uint8_t param)
+{
+    // Every parameter the linked modules read is a boolean enabled by default
+    (void)param;
+    return TRUE;
+}
+
+uint8_t getKeybLutEntryForLayout(uint8_t layout, uint8_t ascii_char)
+{
+    // No keyboard layout in the bench flash, the keyboard endpoint reports are dropped anyway
+    (void)layout;
+    (void)ascii_char;
+    return 0;
+}
@@ -0,0 +1,79 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     sim_reports_test.c
+*    \brief    Host simulator: socket reports FIFO tests
+*    Created:  17/10/2026
+*
+*    Run instead of the firmware when MOOLTIPASS_SIM_REPORTS_TEST is set,
+*    one result line per test: "reportstest <name> <PASSED|FAILED>"
+*/
+#include <stdio.h>
+#include "prog_rig_sockets.h"
+#include "socket_reports.h"
+#include "sim_core.h"
+#include "defines.h"
+
+/* FIFO state, owned by socket_reports.c */
+extern socketReport_t socket_report_buffer[SOCKET_REPORT_BUFFER_SIZE];
+extern uint8_t socket_report_head;
+extern uint8_t socket_report_send_idx;
+
+
+/*! \fn     simReportsDisabledTest(void)
+*   \brief  Queue more events than the FIFO holds while the reports are disabled, then enable them
+*   \return RETURN_OK if no stale event is sent and the next event is
+*/
+static RET_TYPE simReportsDisabledTest(void)
+{
+    enableSocketReports(FALSE);
+    for (uint8_t i = 0; i < SOCKET_REPORT_BUFFER_SIZE + 8; i++)
+    {
+        queueSocketReport(i % NB_PROG_RIGS, SOCKET_REPORT_READY);
+    }
+    
+    enableSocketReports(TRUE);
+    if (areSocketReportsPending() != FALSE)
+    {
+        return RETURN_NOK;
+    }
+    
+    queueSocketReport(1, SOCKET_REPORT_SHORTED);
+    if ((areSocketReportsPending() == FALSE) || (((socket_report_head - socket_report_send_idx) & SOCKET_REPORT_BUFFER_MASK) != 1))
+    {
+        return RETURN_NOK;
+    }
+    if ((socket_report_buffer[socket_report_send_idx].socket_id != 1) || (socket_report_buffer[socket_report_send_idx].event_type != SOCKET_REPORT_SHORTED))
+    {
+        return RETURN_NOK;
+    }
+    return RETURN_OK;
+}
+
+/*! \fn     simRunReportsTests(void)
+*   \brief  Run the socket reports tests
+*   \return The process exit status: 0 if they all passed
+*/
+int simRunReportsTests(void)
+{
+    RET_TYPE ret = simReportsDisabledTest();
+    
+    simPrintf("reportstest fifo_full_then_enable %s\n", (ret == RETURN_OK) ? "PASSED" : "FAILED");
+    return (ret == RETURN_OK) ? 0 : 1;
+}
@@ -0,0 +1,209 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     sim_timer_test.c
+*    \brief    Host simulator: timer manager tests
+*    Created:  17/10/2026
+*
+*    Run instead of the firmware when MOOLTIPASS_SIM_TIMER_TEST is set,
+*    one result line per test: "timertest <name> <PASSED|FAILED>"
+*/
+#include <stdio.h>
+#include "timer_manager.h"
+#include "sim_core.h"
+#include "defines.h"
+
+/* Random operations run against the timer manager and the reference */
+#define SIM_TIMER_TEST_NB_OPS       200000UL
+#define SIM_TIMER_TEST_SEED         0x12345678UL
+
+/* Reference: the per tick countdown of each timer, in ms, and its expiry flag */
+static uint32_t sim_ref_timer_val[TOTAL_NUMBER_OF_TIMERS];
+static uint8_t sim_ref_timer_flag[TOTAL_NUMBER_OF_TIMERS];
+/* Callbacks the reference expects and callbacks the timer manager made */
+static uint32_t sim_ref_nb_callbacks;
+static uint32_t sim_nb_callbacks;
+static uint32_t sim_timer_test_rand_state;
+
+
+/*! \fn     simTimerTestRand(void)
+*   \brief  Deterministic pseudo random generator, so that a failure can be reproduced
+*   \return 16 random bits
+*/
+static uint16_t simTimerTestRand(void)
+{
+    sim_timer_test_rand_state = sim_timer_test_rand_state * 1103515245UL + 12345UL;
+    return (uint16_t)(sim_timer_test_rand_state >> 16);
+}
+
+/*! \fn     simTimerTestCallback(void)
+*   \brief  Callback set on every timer
+*/
+static void simTimerTestCallback(void)
+{
+    sim_nb_callbacks++;
+}
+
+/*! \fn     simRefActivateTimer(uint8_t uid, uint16_t val)
+*   \brief  Reference activateTimer()
+*   \param  uid     Unique ID
+*   \param  val     Delay, in ms for fast timers or in 65536ms units for slow timers
+*/
+static void simRefActivateTimer(uint8_t uid, uint16_t val)
+{
+    // Stopping a stopped timer doesn't change its flag
+    if ((val == 0) && (sim_ref_timer_val[uid] == 0))
+    {
+        return;
+    }
+    sim_ref_timer_val[uid] = (uid < NUMBER_OF_FAST_TIMERS) ? val : ((uint32_t)val << 16);
+    sim_ref_timer_flag[uid] = (val == 0) ? TIMER_EXPIRED : TIMER_RUNNING;
+}
+
+/*! \fn     simRefTick(void)
+*   \brief  Reference timerManagerTick(): every running timer is decremented
+*/
+static void simRefTick(void)
+{
+    for (uint8_t i = 0; i < TOTAL_NUMBER_OF_TIMERS; i++)
+    {
+        if ((sim_ref_timer_val[i] != 0) && (--sim_ref_timer_val[i] == 0))
+        {
+            sim_ref_timer_flag[i] = TIMER_EXPIRED;
+            sim_ref_nb_callbacks++;
+        }
+    }
+}
+
+/*! \fn     simRefGetTimerVal(uint8_t uid)
+*   \brief  Reference getTimerVal()
+*   \param  uid     Unique ID
+*   \return the timer val, in ms for fast timers or in 65536ms units for slow timers
+*/
+static uint16_t simRefGetTimerVal(uint8_t uid)
+{
+    if (uid < NUMBER_OF_FAST_TIMERS)
+    {
+        return (uint16_t)sim_ref_timer_val[uid];
+    }
+    return (uint16_t)((sim_ref_timer_val[uid] + 0xFFFF) >> 16);
+}
+
+/*! \fn     simTimerDeltaListTest(void)
+*   \brief  Run random activate, read, flag check and tick operations on the timer manager and on a per tick countdown
+*   \return RETURN_OK if both always agree
+*/
+static RET_TYPE simTimerDeltaListTest(void)
+{
+    sim_timer_test_rand_state = SIM_TIMER_TEST_SEED;
+    for (uint8_t i = 0; i < TOTAL_NUMBER_OF_TIMERS; i++)
+    {
+        sim_ref_timer_flag[i] = hasTimerExpired(i, FALSE);
+        setTimerCallback(i, simTimerTestCallback);
+    }
+
+    for (uint32_t op = 0; op < SIM_TIMER_TEST_NB_OPS; op++)
+    {
+        uint16_t rand_val = simTimerTestRand();
+        uint8_t uid = simTimerTestRand() % TOTAL_NUMBER_OF_TIMERS;
+
+        switch (rand_val & 0x03)
+        {
+            case 0:
+            {
+                // Slow timers are only re-armed once in a while, so that they get to expire
+                uint16_t val;
+                if (uid >= NUMBER_OF_FAST_TIMERS)
+                {
+                    if ((simTimerTestRand() & 0x1FF) != 0)
+                    {
+                        break;
+                    }
+                    val = (rand_val >> 2) & 0x01;
+                }
+                else if ((rand_val & 0x70) == 0)
+                {
+                    // Stop the timer
+                    val = 0;
+                }
+                else
+                {
+                    // Short delays, so that timers often expire on the same tick
+                    val = (rand_val >> 7) & 0x1F;
+                }
+                activateTimer(uid, val);
+                simRefActivateTimer(uid, val);
+                break;
+            }
+            case 1:
+            {
+                if (getTimerVal(uid) != simRefGetTimerVal(uid))
+                {
+                    simPrintf("timertest op %lu: timer %u val %u instead of %u\n", (unsigned long)op, uid, getTimerVal(uid), simRefGetTimerVal(uid));
+                    return RETURN_NOK;
+                }
+                break;
+            }
+            case 2:
+            {
+                uint8_t clear = ((rand_val & 0x04) != 0) ? TRUE : FALSE;
+                if (hasTimerExpired(uid, clear) != sim_ref_timer_flag[uid])
+                {
+                    simPrintf("timertest op %lu: timer %u flag %u instead of %u\n", (unsigned long)op, uid, hasTimerExpired(uid, FALSE), sim_ref_timer_flag[uid]);
+                    return RETURN_NOK;
+                }
+                if ((clear == TRUE) && (sim_ref_timer_flag[uid] == TIMER_EXPIRED))
+                {
+                    sim_ref_timer_flag[uid] = TIMER_RUNNING;
+                }
+                break;
+            }
+            default:
+            {
+                timerManagerTick();
+                simRefTick();
+                timerManagerRunCallbacks();
+                if (sim_nb_callbacks != sim_ref_nb_callbacks)
+                {
+                    simPrintf("timertest op %lu: %lu callbacks instead of %lu\n", (unsigned long)op, (unsigned long)sim_nb_callbacks, (unsigned long)sim_ref_nb_callbacks);
+                    return RETURN_NOK;
+                }
+                break;
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < TOTAL_NUMBER_OF_TIMERS; i++)
+    {
+        setTimerCallback(i, 0);
+    }
+    return RETURN_OK;
+}
+
+/*! \fn     simRunTimerTests(void)
+*   \brief  Run the timer manager tests
+*   \return The process exit status: 0 if they all passed
+*/
+int simRunTimerTests(void)
+{
+    RET_TYPE ret = simTimerDeltaListTest();
+
+    simPrintf("timertest delta_list_vs_countdown %s\n", (ret == RETURN_OK) ? "PASSED" : "FAILED");
+    return (ret == RETURN_OK) ? 0 : 1;
+}
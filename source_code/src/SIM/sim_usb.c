@@ -0,0 +1,472 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     sim_usb.c
+*    \brief    Host simulator: USB controller
+*    Created:  17/10/2026
+*
+*    The USB controller registers usb.c uses are modelled so that its
+*    interrupts and endpoint handling run unmodified. The host side connects
+*    to a SOCK_SEQPACKET unix socket, each datagram being one 64 bytes raw
+*    HID report. A host connecting resets the bus, then the model loads the
+*    SET_ADDRESS and SET_CONFIGURATION setup packets the vector answers.
+*    GET_DESCRIPTOR isn't sent: the descriptor list holds AVR program
+*    memory addresses, which pgm_read_word() can't turn into host pointers,
+*    so it is left empty here.
+*
+*    The raw HID OUT and IN endpoints have two banks each, shared with the
+*    I/O thread which owns the socket: it only reads a report from the host
+*    once a bank is released, like the controller NAKs the host, and sends
+*    the banks the firmware fills.
+*
+*    UEINTX and UEDATX go through accessors: each access first commits the
+*    write of the previous one, then publishes the value the current
+*    endpoint reads. Clearing FIFOCON releases the bank, UEDATX writes go to
+*    the IN bank being filled.
+*/
+#define _GNU_SOURCE
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include "usb_descriptors.h"
+#include "sim_core.h"
+#include "defines.h"
+#include "usb.h"
+
+/* Endpoints */
+#define SIM_USB_NB_ENDPOINTS    8               // UENUM values
+#define SIM_USB_NB_BANKS        2               // Raw HID endpoint banks, power of 2
+#define SIM_USB_BANK_MASK       (SIM_USB_NB_BANKS-1)
+#define SIM_USB_NO_WRITE        0xFF            // No UEDATX write to commit
+#define SIM_USB_SETUP_SIZE      8
+
+/* Setup packets the host sends once connected */
+static const uint8_t sim_usb_setups[][SIM_USB_SETUP_SIZE] =
+{
+    {0x00, SET_ADDRESS, 1, 0, 0, 0, 0, 0},
+    {0x00, SET_CONFIGURATION, 1, 0, 0, 0, 0, 0}
+};
+#define SIM_USB_NB_SETUPS       (sizeof(sim_usb_setups) / SIM_USB_SETUP_SIZE)
+
+/* Replaces usb_descriptors.c, whose UTF-16 strings don't build on the host: GET_DESCRIPTOR isn't sent */
+const descriptor_list_struct_t descriptor_list[9];
+
+/* Registers: PLLCSR, per endpoint UECONX / UECFG0X / UECFG1X / UEIENX */
+static volatile uint8_t sim_usb_pllcsr;
+static volatile uint8_t sim_usb_ep_regs[SIM_USB_NB_ENDPOINTS][SIM_UEIENX + 1];
+/* UEINTX: value read by the firmware, value published and endpoint it was published for */
+static volatile uint8_t sim_usb_ueintx;
+static uint8_t sim_usb_ueintx_published;
+static uint8_t sim_usb_ueintx_ep;
+/* UEDATX: value read by the firmware, endpoint of the write to commit */
+static volatile uint8_t sim_usb_uedatx;
+static uint8_t sim_usb_uedatx_write_ep = SIM_USB_NO_WRITE;
+/* Control endpoint: next setup packet to load, loaded one, bytes read */
+static uint8_t sim_usb_setup_next = SIM_USB_NB_SETUPS;
+static uint8_t sim_usb_setup_loaded = FALSE;
+static uint8_t sim_usb_setup_idx;
+/* Raw HID IN banks: pushed is only written by the firmware, sent only by the I/O thread */
+static uint8_t sim_usb_tx_banks[SIM_USB_NB_BANKS][RAWHID_TX_SIZE];
+static uint8_t sim_usb_tx_len;
+static uint32_t sim_usb_tx_pushed;
+static uint32_t sim_usb_tx_sent;
+/* Raw HID OUT banks: head is only written by the I/O thread, tail only by the firmware */
+static uint8_t sim_usb_rx_banks[SIM_USB_NB_BANKS][RAWHID_RX_SIZE];
+static uint8_t sim_usb_rx_idx;
+static uint32_t sim_usb_rx_head;
+static uint32_t sim_usb_rx_tail;
+/* Host connections: generation bumped by the I/O thread, acknowledged by the model once the bus is reset */
+static uint8_t sim_usb_connected = FALSE;
+static uint32_t sim_usb_generation;
+static uint32_t sim_usb_generation_ack;
+/* Sockets, owned by the I/O thread */
+static int sim_usb_listen_fd = -1;
+static int sim_usb_host_fd = -1;
+
+
+/*! \fn     simUsbInit(const char* socket_path)
+*   \brief  Create the socket the host connects to
+*   \param  socket_path     The socket path
+*/
+void simUsbInit(const char* socket_path)
+{
+    struct sockaddr_un addr;
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, socket_path, sizeof(addr.sun_path) - 1);
+    unlink(socket_path);
+    
+    sim_usb_listen_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK, 0);
+    if ((sim_usb_listen_fd < 0) || (bind(sim_usb_listen_fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) || (listen(sim_usb_listen_fd, 1) < 0))
+    {
+        simPrintf("usb cannot listen on %s\n", socket_path);
+        return;
+    }
+    simPrintf("usb listening on %s\n", socket_path);
+}
+
+/*! \fn     simUsbEndpointInterrupts(void)
+*   \brief  Endpoint interrupts raised and enabled
+*   \return The UEINT value
+*/
+static uint8_t simUsbEndpointInterrupts(void)
+{
+    uint8_t ret_val = 0;
+    
+    if ((sim_usb_setup_loaded != FALSE) && (sim_usb_ep_regs[0][SIM_UEIENX] & (1 << RXSTPE)))
+    {
+        ret_val |= (1 << 0);
+    }
+    if ((sim_usb_rx_tail != __atomic_load_n(&sim_usb_rx_head, __ATOMIC_ACQUIRE)) && (sim_usb_ep_regs[RAWHID_RX_ENDPOINT][SIM_UEIENX] & (1 << RXOUTE)))
+    {
+        ret_val |= (1 << RAWHID_RX_ENDPOINT);
+    }
+    return ret_val;
+}
+
+/*! \fn     simUsbCommitData(void)
+*   \brief  Commit the UEDATX write of the previous access
+*/
+static void simUsbCommitData(void)
+{
+    if ((sim_usb_uedatx_write_ep == RAWHID_TX_ENDPOINT) && (sim_usb_tx_len < RAWHID_TX_SIZE))
+    {
+        sim_usb_tx_banks[sim_usb_tx_pushed & SIM_USB_BANK_MASK][sim_usb_tx_len++] = sim_usb_uedatx;
+    }
+    sim_usb_uedatx_write_ep = SIM_USB_NO_WRITE;
+}
+
+/*! \fn     simUsbCommitInt(void)
+*   \brief  Commit the UEINTX write of the previous access: the flags cleared take effect
+*/
+static void simUsbCommitInt(void)
+{
+    uint8_t cleared = sim_usb_ueintx_published & ~sim_usb_ueintx;
+    
+    sim_usb_ueintx_published = sim_usb_ueintx;
+    if ((sim_usb_ueintx_ep == 0) && (cleared & (1 << RXSTPI)))
+    {
+        sim_usb_setup_loaded = FALSE;
+    }
+    else if ((sim_usb_ueintx_ep == RAWHID_TX_ENDPOINT) && (cleared & (1 << FIFOCON)))
+    {
+        // Bank filled: hand it to the I/O thread, short packets being zero padded
+        memset(&sim_usb_tx_banks[sim_usb_tx_pushed & SIM_USB_BANK_MASK][sim_usb_tx_len], 0x00, RAWHID_TX_SIZE - sim_usb_tx_len);
+        sim_usb_tx_len = 0;
+        __atomic_store_n(&sim_usb_tx_pushed, sim_usb_tx_pushed + 1, __ATOMIC_RELEASE);
+        simWakeIoThread();
+    }
+    else if ((sim_usb_ueintx_ep == RAWHID_RX_ENDPOINT) && (cleared & (1 << FIFOCON)))
+    {
+        // Bank read: the I/O thread may fill it with the next report
+        sim_usb_rx_idx = 0;
+        __atomic_store_n(&sim_usb_rx_tail, sim_usb_rx_tail + 1, __ATOMIC_RELEASE);
+        simWakeIoThread();
+    }
+}
+
+/*! \fn     simUsbIntReg(void)
+*   \brief  UEINTX: commit the previous write, publish the flags of the selected endpoint
+*   \return The register
+*/
+volatile uint8_t* simUsbIntReg(void)
+{
+    uint8_t ep = UENUM & (SIM_USB_NB_ENDPOINTS - 1);
+    uint8_t value = 0;
+    
+    simEnterModel();
+    simUsbCommitData();
+    simUsbCommitInt();
+    if (ep == 0)
+    {
+        // IN packets of the control endpoint are taken by the host right away
+        value = (1 << TXINI) | ((sim_usb_setup_loaded != FALSE) ? (1 << RXSTPI) : 0);
+    }
+    else if (ep == RAWHID_TX_ENDPOINT)
+    {
+        if ((__atomic_load_n(&sim_usb_tx_pushed, __ATOMIC_RELAXED) - __atomic_load_n(&sim_usb_tx_sent, __ATOMIC_ACQUIRE)) < SIM_USB_NB_BANKS)
+        {
+            value = (1 << FIFOCON) | (1 << RWAL) | (1 << TXINI);
+        }
+    }
+    else if (ep == RAWHID_RX_ENDPOINT)
+    {
+        if (sim_usb_rx_tail != __atomic_load_n(&sim_usb_rx_head, __ATOMIC_ACQUIRE))
+        {
+            value = (1 << FIFOCON) | (1 << RWAL) | (1 << RXOUTI);
+        }
+    }
+    else if (ep == KEYBOARD_ENDPOINT)
+    {
+        // No keyboard host: the reports are dropped
+        value = (1 << FIFOCON) | (1 << RWAL) | (1 << TXINI);
+    }
+    sim_usb_ueintx = value;
+    sim_usb_ueintx_published = value;
+    sim_usb_ueintx_ep = ep;
+    simLeaveModel();
+    return &sim_usb_ueintx;
+}
+
+/*! \fn     simUsbDataReg(void)
+*   \brief  UEDATX: commit the previous write, publish the next byte of the selected endpoint
+*   \return The register
+*/
+volatile uint8_t* simUsbDataReg(void)
+{
+    uint8_t ep = UENUM & (SIM_USB_NB_ENDPOINTS - 1);
+    
+    simEnterModel();
+    simUsbCommitData();
+    sim_usb_uedatx = 0;
+    if (ep == 0)
+    {
+        // Data stage of the control transfers: only the setup packets are modelled
+        if ((sim_usb_setup_loaded != FALSE) && (sim_usb_setup_idx < SIM_USB_SETUP_SIZE))
+        {
+            sim_usb_uedatx = sim_usb_setups[sim_usb_setup_next - 1][sim_usb_setup_idx++];
+        }
+    }
+    else if (ep == RAWHID_RX_ENDPOINT)
+    {
+        if ((sim_usb_rx_tail != __atomic_load_n(&sim_usb_rx_head, __ATOMIC_ACQUIRE)) && (sim_usb_rx_idx < RAWHID_RX_SIZE))
+        {
+            sim_usb_uedatx = sim_usb_rx_banks[sim_usb_rx_tail & SIM_USB_BANK_MASK][sim_usb_rx_idx++];
+        }
+    }
+    else
+    {
+        sim_usb_uedatx_write_ep = ep;
+    }
+    simLeaveModel();
+    return &sim_usb_uedatx;
+}
+
+/*! \fn     simUsbEndpointReg(uint8_t reg)
+*   \brief  UECONX, UECFG0X, UECFG1X and UEIENX of the selected endpoint
+*   \param  reg     SIM_UECONX, SIM_UECFG0X, SIM_UECFG1X or SIM_UEIENX
+*   \return The register
+*/
+volatile uint8_t* simUsbEndpointReg(uint8_t reg)
+{
+    return &sim_usb_ep_regs[UENUM & (SIM_USB_NB_ENDPOINTS - 1)][reg];
+}
+
+/*! \fn     simUsbPllReg(void)
+*   \brief  PLLCSR: the PLL locks as soon as it is enabled
+*   \return The register
+*/
+volatile uint8_t* simUsbPllReg(void)
+{
+    if (sim_usb_pllcsr & (1 << PLLE))
+    {
+        sim_usb_pllcsr |= (1 << PLOCK);
+    }
+    return &sim_usb_pllcsr;
+}
+
+/*! \fn     simUsbGetEndpointInterrupts(void)
+*   \brief  UEINT
+*   \return The endpoint interrupts raised and enabled
+*/
+uint8_t simUsbGetEndpointInterrupts(void)
+{
+    uint8_t ret_val;
+    
+    simEnterModel();
+    ret_val = simUsbEndpointInterrupts();
+    simLeaveModel();
+    return ret_val;
+}
+
+/*! \fn     simUsbTick(void)
+*   \brief  Bus reset on host connections, start of frame and setup packets, called by the tick
+*/
+void simUsbTick(void)
+{
+    uint32_t generation = __atomic_load_n(&sim_usb_generation, __ATOMIC_ACQUIRE);
+    
+    // UEDATX isn't committed here: the write may still be to come
+    simUsbCommitInt();
+    
+    if (generation != sim_usb_generation_ack)
+    {
+        // Bus reset: the endpoints but the control one are disabled, the OUT banks are dropped
+        UDINT |= (1 << EORSTI);
+        memset((uint8_t*)sim_usb_ep_regs[1], 0x00, sizeof(sim_usb_ep_regs) - sizeof(sim_usb_ep_regs[0]));
+        sim_usb_rx_idx = 0;
+        __atomic_store_n(&sim_usb_rx_tail, __atomic_load_n(&sim_usb_rx_head, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+        sim_usb_setup_loaded = FALSE;
+        sim_usb_setup_next = (__atomic_load_n(&sim_usb_connected, __ATOMIC_ACQUIRE) != FALSE) ? 0 : SIM_USB_NB_SETUPS;
+        __atomic_store_n(&sim_usb_generation_ack, generation, __ATOMIC_RELEASE);
+        simWakeIoThread();
+    }
+    
+    if (__atomic_load_n(&sim_usb_connected, __ATOMIC_ACQUIRE) != FALSE)
+    {
+        UDINT |= (1 << SOFI);
+    }
+    
+    // Next setup packet, once the previous one is acknowledged
+    if ((sim_usb_setup_loaded == FALSE) && (sim_usb_setup_next < SIM_USB_NB_SETUPS) && (sim_usb_ep_regs[0][SIM_UEIENX] & (1 << RXSTPE)))
+    {
+        sim_usb_setup_next++;
+        sim_usb_setup_idx = 0;
+        sim_usb_setup_loaded = TRUE;
+    }
+}
+
+/*! \fn     simUsbGenPending(void)
+*   \brief  Know if the USB general vector is to be run
+*   \return TRUE or FALSE
+*/
+uint8_t simUsbGenPending(void)
+{
+    return (UDINT & UDIEN & ((1 << EORSTI) | (1 << SOFI))) ? TRUE : FALSE;
+}
+
+/*! \fn     simUsbComPending(void)
+*   \brief  Know if the USB endpoint vector is to be run
+*   \return TRUE or FALSE
+*/
+uint8_t simUsbComPending(void)
+{
+    return (simUsbEndpointInterrupts() != 0) ? TRUE : FALSE;
+}
+
+/*! \fn     simUsbIoDisconnect(void)
+*   \brief  I/O thread: the host went away
+*/
+static void simUsbIoDisconnect(void)
+{
+    close(sim_usb_host_fd);
+    sim_usb_host_fd = -1;
+    __atomic_store_n(&sim_usb_connected, FALSE, __ATOMIC_RELAXED);
+    __atomic_store_n(&sim_usb_generation, sim_usb_generation + 1, __ATOMIC_RELEASE);
+    simPrintf("usb host disconnected\n");
+}
+
+/*! \fn     simUsbIoRxReady(void)
+*   \brief  I/O thread: know if a report from the host can be taken
+*   \return TRUE if the bus reset is done and an OUT bank is free
+*/
+static uint8_t simUsbIoRxReady(void)
+{
+    if (__atomic_load_n(&sim_usb_generation_ack, __ATOMIC_ACQUIRE) != sim_usb_generation)
+    {
+        return FALSE;
+    }
+    return ((sim_usb_rx_head - __atomic_load_n(&sim_usb_rx_tail, __ATOMIC_ACQUIRE)) < SIM_USB_NB_BANKS) ? TRUE : FALSE;
+}
+
+/*! \fn     simUsbIoPrepare(struct pollfd* pfd)
+*   \brief  I/O thread: events to wait for on the USB sockets
+*   \param  pfd     The poll entry to fill
+*/
+void simUsbIoPrepare(struct pollfd* pfd)
+{
+    pfd->revents = 0;
+    pfd->events = 0;
+    if (sim_usb_host_fd < 0)
+    {
+        pfd->fd = sim_usb_listen_fd;
+        pfd->events = POLLIN;
+        return;
+    }
+    pfd->fd = sim_usb_host_fd;
+    if (simUsbIoRxReady() != FALSE)
+    {
+        pfd->events |= POLLIN;
+    }
+    if (sim_usb_tx_sent != __atomic_load_n(&sim_usb_tx_pushed, __ATOMIC_ACQUIRE))
+    {
+        pfd->events |= POLLOUT;
+    }
+}
+
+/*! \fn     simUsbIoProcess(struct pollfd* pfd)
+*   \brief  I/O thread: accept a host, move its reports to the free OUT banks, send the filled IN banks
+*   \param  pfd     The poll entry filled by simUsbIoPrepare()
+*/
+void simUsbIoProcess(struct pollfd* pfd)
+{
+    ssize_t len;
+    int new_fd;
+    
+    if (sim_usb_host_fd < 0)
+    {
+        // No host: the IN packets are lost
+        __atomic_store_n(&sim_usb_tx_sent, __atomic_load_n(&sim_usb_tx_pushed, __ATOMIC_ACQUIRE), __ATOMIC_RELEASE);
+        if ((sim_usb_listen_fd >= 0) && (pfd->revents & POLLIN))
+        {
+            new_fd = accept4(sim_usb_listen_fd, 0, 0, SOCK_NONBLOCK);
+            if (new_fd >= 0)
+            {
+                sim_usb_host_fd = new_fd;
+                __atomic_store_n(&sim_usb_connected, TRUE, __ATOMIC_RELAXED);
+                __atomic_store_n(&sim_usb_generation, sim_usb_generation + 1, __ATOMIC_RELEASE);
+                simPrintf("usb host connected\n");
+            }
+        }
+        return;
+    }
+    
+    while (simUsbIoRxReady() != FALSE)
+    {
+        len = recv(sim_usb_host_fd, sim_usb_rx_banks[sim_usb_rx_head & SIM_USB_BANK_MASK], RAWHID_RX_SIZE, MSG_DONTWAIT);
+        if (len == 0)
+        {
+            simUsbIoDisconnect();
+            return;
+        }
+        if (len < 0)
+        {
+            break;
+        }
+        // Short reports are zero padded, like the host HID stack does
+        memset(&sim_usb_rx_banks[sim_usb_rx_head & SIM_USB_BANK_MASK][len], 0x00, RAWHID_RX_SIZE - len);
+        __atomic_store_n(&sim_usb_rx_head, sim_usb_rx_head + 1, __ATOMIC_RELEASE);
+    }
+    
+    while (sim_usb_tx_sent != __atomic_load_n(&sim_usb_tx_pushed, __ATOMIC_ACQUIRE))
+    {
+        len = send(sim_usb_host_fd, sim_usb_tx_banks[sim_usb_tx_sent & SIM_USB_BANK_MASK], RAWHID_TX_SIZE, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if ((len < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK)))
+        {
+            // Host not reading: the banks stay busy, the firmware times out
+            break;
+        }
+        if (len < 0)
+        {
+            simUsbIoDisconnect();
+            return;
+        }
+        __atomic_store_n(&sim_usb_tx_sent, sim_usb_tx_sent + 1, __ATOMIC_RELEASE);
+    }
+    
+    // Hung up while the OUT banks are busy: not waiting for them to be read
+    if (pfd->revents & (POLLHUP | POLLERR))
+    {
+        simUsbIoDisconnect();
+    }
+}
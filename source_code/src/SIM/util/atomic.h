@@ -0,0 +1,54 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     atomic.h
+*    \brief    Host simulator: atomic blocks
+*    Created:  17/10/2026
+*/
+#ifndef SIM_UTIL_ATOMIC_H_
+#define SIM_UTIL_ATOMIC_H_
+
+#include <avr/interrupt.h>
+
+static inline uint8_t simAtomicEnter(void)
+{
+    cli();
+    return 1;
+}
+
+static inline void simAtomicRestore(const uint8_t* sreg)
+{
+    SREG = *sreg;
+    if (*sreg & (1 << SREG_I))
+    {
+        sei();
+    }
+}
+
+static inline void simAtomicForceOn(const uint8_t* sreg)
+{
+    (void)sreg;
+    sei();
+}
+
+#define ATOMIC_BLOCK(type)          for (type, sim_atomic_todo = simAtomicEnter(); sim_atomic_todo; sim_atomic_todo = 0)
+#define ATOMIC_RESTORESTATE         uint8_t sim_sreg_save __attribute__((__cleanup__(simAtomicRestore))) = SREG
+#define ATOMIC_FORCEON              uint8_t sim_sreg_save __attribute__((__cleanup__(simAtomicForceOn))) = 0
+
+#endif /* SIM_UTIL_ATOMIC_H_ */
@@ -55,6 +55,97 @@ void spiUsartSetRate(uint16_t rate)
     UBRR1 = rate;
 }
 
+#ifndef MOOLTIPASS_SIMULATOR
+/**
+ * read a number of bytes from SPI USART interface, keeping the transmitter busy
+ * @param data - pointer to buffer to store data in
+ * @param size - number of bytes to read
+ * @note the receive buffer must be empty, the next byte is loaded before the previous one is read
+ */
+void spiUsartRead(uint8_t* data, uint16_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    
+    /* Wait for empty transmit buffer */
+    while (!(UCSR1A & (1<<UDRE1)));
+    UDR1 = 0;
+    while (--size)
+    {
+        /* Queue the next byte while the current one is shifted */
+        while (!(UCSR1A & (1<<UDRE1)));
+        UDR1 = 0;
+        /* Wait for the current byte to be received */
+        while (!(UCSR1A & (1<<RXC1)));
+        *data++ = UDR1;
+    }
+    while (!(UCSR1A & (1<<RXC1)));
+    *data = UDR1;
+}
+
+/**
+ * write a number of bytes to SPI USART interface, keeping the transmitter busy
+ * @param data - pointer to buffer of data to write
+ * @param size - number of bytes to write
+ * @note the receive buffer must be empty, the next byte is loaded before the previous one is received
+ */
+void spiUsartWrite(uint8_t* data, uint16_t size)
+{
+    if (size == 0)
+    {
+        return;
+    }
+    
+    /* Wait for empty transmit buffer */
+    while (!(UCSR1A & (1<<UDRE1)));
+    UDR1 = *data++;
+    while (--size)
+    {
+        /* Queue the next byte while the current one is shifted */
+        while (!(UCSR1A & (1<<UDRE1)));
+        UDR1 = *data++;
+        /* Wait for the current byte to be received */
+        while (!(UCSR1A & (1<<RXC1)));
+        UDR1;
+    }
+    while (!(UCSR1A & (1<<RXC1)));
+    UDR1;
+}
+
+/**
+ * send a number of bytes to SPI USART interface, replacing them with the received ones
+ * @param data - pointer to buffer of data to write, overwritten with the read data
+ * @param size - number of bytes to transfer
+ * @note the receive buffer must be empty, the next byte is loaded before the previous one is read
+ */
+void spiUsartReadWrite(uint8_t* data, uint16_t size)
+{
+    uint8_t* rx_data = data;
+    
+    if (size == 0)
+    {
+        return;
+    }
+    
+    /* Wait for empty transmit buffer */
+    while (!(UCSR1A & (1<<UDRE1)));
+    UDR1 = *data++;
+    while (--size)
+    {
+        /* Queue the next byte while the current one is shifted */
+        while (!(UCSR1A & (1<<UDRE1)));
+        UDR1 = *data++;
+        /* Wait for the current byte to be received */
+        while (!(UCSR1A & (1<<RXC1)));
+        *rx_data++ = UDR1;
+    }
+    while (!(UCSR1A & (1<<RXC1)));
+    *rx_data = UDR1;
+}
+#endif
+
 #ifdef MINI_BOOTLOADER
 /**
  * send and receive a byte of data via the SPI USART interface.
@@ -47,8 +47,11 @@
 
 void spiUsartBegin(void);
 void spiUsartSetRate(uint16_t rate);
+void spiUsartRead(uint8_t* data, uint16_t size);
+void spiUsartWrite(uint8_t* data, uint16_t size);
+void spiUsartReadWrite(uint8_t* data, uint16_t size);
 
-#ifndef MINI_BOOTLOADER
+#if !defined(MINI_BOOTLOADER) && !defined(MOOLTIPASS_SIMULATOR)
 /**
  * send and receive a byte of data via the SPI USART interface.
  * @param data - the byte to send
@@ -104,40 +107,4 @@ static inline void spiUsartWaitEndSendTransfer(void)
     UDR1;
 }
 
-/**
- * read a number of bytes from SPI USART interface.
- * @param data - pointer to buffer to store data in
- * @param size - number of bytes to read
- */
-static inline void spiUsartRead(uint8_t *data, uint16_t size)
-{
-    while (size--)
-    {
-        /* Wait for empty transmit buffer */
-        while (!(UCSR1A & (1<<UDRE1)));
-        UDR1 = 0;
-        /* Wait for data to be received */
-        while (!(UCSR1A & (1<<RXC1)));
-        *data++ = UDR1;
-    }
-}
-
-/**
- * write a number of bytes to SPI USART interface.
- * @param data - pointer to buffer of data to write
- * @param size - number of bytes to write
- */
-static inline void spiUsartWrite(uint8_t *data, uint16_t size)
-{
-    while (size--)
-    {
-        /* Wait for empty transmit buffer */
-        while (!(UCSR1A & (1<<UDRE1)));
-        UDR1 = *data++;
-        /* Wait for data to be received */
-        while (!(UCSR1A & (1<<RXC1)));
-        UDR1;
-    }
-}
-
 #endif
@@ -26,6 +26,7 @@
 #include "oled_wrapper.h"
 #include "hid_defines.h"
 #include "mooltipass.h"
+#include "scheduler.h"
 #include "defines.h"
 #include "usb.h"
 #include <string.h>
@@ -74,6 +75,11 @@ static const uint8_t PROGMEM endpoint_config_table[] =
     0
 };
 
+// Raw HID reception ring: head is only written by the USB interrupt, tail only by the main loop
+static volatile uint8_t usb_rx_ring[USB_RX_RING_SIZE][RAWHID_RX_SIZE];
+static volatile uint8_t usb_rx_head = 0;
+static volatile uint8_t usb_rx_tail = 0;
+
 
 #ifdef USB_OLED_DEBUG_COMMS
 /*! \fn     displayDebugStatusCode(char* text)
@@ -115,6 +121,28 @@ uint8_t isUsbConfigured(void)
     return usb_configuration;
 }
 
+/*! \fn     isUsbHidTxReady(void)
+*   \brief  Know if the raw HID IN endpoint can accept a packet without waiting
+*   \return TRUE or FALSE
+*/
+uint8_t isUsbHidTxReady(void)
+{
+    uint8_t intr_state, ret_val = FALSE;
+
+    if (usb_configuration)
+    {
+        intr_state = SREG;
+        cli();
+        UENUM = RAWHID_TX_ENDPOINT;
+        if (UEINTX & (1<<RWAL))
+        {
+            ret_val = TRUE;
+        }
+        SREG = intr_state;
+    }
+    return ret_val;
+}
+
 /*! \fn     usbKeyboardSend(void)
 *   \brief  Send the contents of keyboard_keys and keyboard_modifier_keys
 *   \return If we managed to send the keyboard keys
@@ -212,57 +240,80 @@ uint8_t getKeyboardLeds(void)
     return keyboard_leds;
 }
 
-/*! \fn     usbRawHidRecv(uint8_t *buffer, uint8_t timeout)
-*   \brief  Receive a packet, with timeout
+/*! \fn     isUsbRawHidRxPending(void)
+*   \brief  Know if a raw HID packet is waiting to be read
+*   \return TRUE or FALSE
+*/
+uint8_t isUsbRawHidRxPending(void)
+{
+    if (usb_rx_tail != usb_rx_head)
+    {
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*! \fn     usbRawHidRecv(uint8_t *buffer)
+*   \brief  Dequeue a packet received by the USB interrupt, doesn't wait
 *   \param  buffer    Pointer to the buffer to store received data
-*   \return RETURN_COM_TRANSF_OK or RETURN_COM_NOK or RETURN_COM_TIMEOUT
+*   \return RETURN_COM_TRANSF_OK or RETURN_COM_NOK if no packet is queued
 */
 RET_TYPE usbRawHidRecv(uint8_t *buffer)
 {
+    uint8_t tail = usb_rx_tail;
     uint8_t intr_state;
-    uint8_t i = 0;
 
-    // if we're not online (enumerated and configured), error
-    if (!usb_configuration)
+    if (tail == usb_rx_head)
     {
         return RETURN_COM_NOK;
     }
+    for (uint8_t i = 0; i < RAWHID_RX_SIZE; i++)
+    {
+        buffer[i] = usb_rx_ring[tail][i];
+    }
+    usb_rx_tail = (tail + 1) & USB_RX_RING_MASK;
+
+    // A slot is free: let the interrupt accept packets again if it stopped when the ring was full
     intr_state = SREG;
     cli();
-    // Activate timeout timer
-    activateTimer(TIMER_WAIT_FUNCTS, USB_READ_TIMEOUT);
+    if (usb_configuration)
+    {
+        UENUM = RAWHID_RX_ENDPOINT;
+        UEIENX = (1<<RXOUTE);
+    }
+    SREG = intr_state;
+    return RETURN_COM_TRANSF_OK;
+}
+
+/*! \fn     usbRawHidRxInterrupt(void)
+*   \brief  Copy the received raw HID packets into the ring, to be called from the USB interrupt
+*           When the ring is full the endpoint interrupt is masked and the banks are left
+*           untouched, so the host gets NAKed until the main loop dequeues a packet
+*/
+static inline void usbRawHidRxInterrupt(void)
+{
+    uint8_t next_head;
+
     UENUM = RAWHID_RX_ENDPOINT;
-    // wait for data to be available in the FIFO
-    while (1)
+    while ((UEIENX & (1<<RXOUTE)) && (UEINTX & (1<<RXOUTI)))
     {
-        if (UEINTX & (1<<RWAL))
+        next_head = (usb_rx_head + 1) & USB_RX_RING_MASK;
+        if (next_head == usb_rx_tail)
         {
+            UEIENX = 0;
             break;
         }
-        SREG = intr_state;
-        if (hasTimerExpired(TIMER_WAIT_FUNCTS, TRUE) == TIMER_EXPIRED)
-        {
-            return RETURN_COM_TIMEOUT;
-        }
-        if (!usb_configuration)
+        for (uint8_t i = 0; i < RAWHID_RX_SIZE; i++)
         {
-            return RETURN_COM_NOK;
+            usb_rx_ring[usb_rx_head][i] = UEDATX;
         }
-        intr_state = SREG;
-        cli();
-        UENUM = RAWHID_RX_ENDPOINT;
-    }
-    for(i = 0; i < RAWHID_RX_SIZE; i++)
-    {
-        *buffer++ = UEDATX;
+        // release the bank
+        UEINTX = 0x6B;
+        usb_rx_head = next_head;
+        schedulerWakeTask(TASK_USB);
     }
-    // release the buffer
-    UEINTX = 0x6B;
-    SREG = intr_state;
-    return RETURN_COM_TRANSF_OK;
 }
 
-
 /*! \fn     ISR(USB_GEN_vect)
 *   \brief  USB Device Interrupt - handle all device-level events
 *           the transmit buffer flushing is triggered by the start of frame
@@ -338,9 +389,10 @@ static inline void usb_ack_out(void)
 }
 
 /*! \fn     ISR(USB_COM_vect)
-*   \brief  USB Endpoint Interrupt - endpoint 0 is handled here.  The
-*           other endpoints are manipulated by the user-callable
-*           functions, and the start-of-frame interrupt.
+*   \brief  USB Endpoint Interrupt - endpoint 0 and the raw HID OUT
+*           endpoint are handled here. The other endpoints are
+*           manipulated by the user-callable functions, and the
+*           start-of-frame interrupt.
 */
 ISR(USB_COM_vect)
 {
@@ -357,6 +409,16 @@ ISR(USB_COM_vect)
     const uint8_t *desc_addr;
     uint8_t desc_length;
 
+    if (UEINT & (1<<RAWHID_RX_ENDPOINT))
+    {
+        usbRawHidRxInterrupt();
+    }
+    if ((UEINT & (1<<0)) == 0)
+    {
+        // No setup packet on endpoint 0, don't stall it
+        return;
+    }
+
     UENUM = 0;
     intbits = UEINTX;
     if (intbits & (1<<RXSTPI))
@@ -457,6 +519,8 @@ ISR(USB_COM_vect)
             }
             UERST = 0x1E;
             UERST = 0;
+            UENUM = RAWHID_RX_ENDPOINT;
+            UEIENX = (1<<RXOUTE);
             return;
         }
         if (bRequest == GET_CONFIGURATION && bmRequestType == 0x80)
@@ -625,6 +689,8 @@ ISR(USB_COM_vect)
 
 /*!
 *   \brief  Wait for the TX fifo to be ready to accept data.
+*           The raw HID IN endpoint has two banks, so a packet can be
+*           filled while the previous one is waiting for the host.
 *   \param  intr_state   pointer to storage to save the interrupt state
 *   \retval RETURN_TRANSF_COM_OK fifo is ready, and interrupts are disabled
 *   \retval RETURN_COM_TIMEOUT timeout waiting for fifo to be ready
@@ -639,10 +705,15 @@ static RET_TYPE usbWaitFifoReady(uint8_t *intr_state)
     }
     *intr_state = SREG;
     cli();
+    UENUM = RAWHID_TX_ENDPOINT;
+    // With two banks one of them is usually free: don't bother arming the timeout
+    if (UEINTX & (1<<RWAL))
+    {
+        return RETURN_COM_TRANSF_OK;
+    }
     // Activate timeout timer
     activateTimer(TIMER_WAIT_FUNCTS, USB_WRITE_TIMEOUT);
-    UENUM = RAWHID_TX_ENDPOINT;
-    // wait for the FIFO to be ready to accept data
+    // wait for a bank to be released by the host
     while (1)
     {
         if (UEINTX & (1<<RWAL))
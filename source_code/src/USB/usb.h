@@ -37,7 +37,8 @@
 #define KEYBOARD_SIZE       8                   // Endpoint size for keyboard
 #define KEYBOARD_BUFFER     EP_DOUBLE_BUFFER    // Double buffer
 #define USB_WRITE_TIMEOUT   50                  // Timeout for writing in the pipe
-#define USB_READ_TIMEOUT    4                   // Timeout for reading in the pipe
+#define USB_RX_RING_SIZE    4                   // Raw HID packets queued by the USB interrupt, must be a power of 2
+#define USB_RX_RING_MASK    (USB_RX_RING_SIZE-1)
 
 // Endpoint defines
 #define EP_SIZE(s)  ((s) > 32 ? 0x30 : ((s) > 16 ? 0x20 : ((s) > 8  ? 0x10 : 0x00)))
@@ -89,11 +90,13 @@
 /** Function prototypes **/
 void initUsb(void);                                           // initialize everything
 uint8_t isUsbConfigured(void);                                // is the USB port configured
+uint8_t isUsbHidTxReady(void);                                // can a raw HID packet be sent without waiting
+uint8_t isUsbRawHidRxPending(void);                           // is a raw HID packet waiting to be read
 uint8_t getKeyboardLeds(void);                                // get keyboard LEDs
 void usbSendLockShortcut(void);                               // send lock shortcut through usb
 RET_TYPE usbKeybPutChar(char ch);                             // type char
 RET_TYPE usbKeybPutStr(char* string);                         // type string
-RET_TYPE usbRawHidRecv(uint8_t* buffer);                      // receive a packet, with timeout
+RET_TYPE usbRawHidRecv(uint8_t* buffer);                      // dequeue a received packet
 RET_TYPE usbRawHidSend(uint8_t* buffer);
 RET_TYPE usbHidSend(uint8_t cmd, const void *buffer, uint8_t buflen);
 RET_TYPE usbHidSend_P(uint8_t cmd, const void *buffer, uint8_t buflen);
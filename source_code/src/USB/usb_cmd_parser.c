@@ -29,7 +29,11 @@
 #include "gui_basic_functions.h"
 #include "logic_aes_and_comms.h"
 #include "gui_pin_functions.h"
+#include "prog_rig_sockets.h"
 #include "eeprom_addresses.h"
+#include "socket_reports.h"
+#include "socket_latency.h"
+#include "socket_stats.h"
 #include "watchdog_driver.h"
 #include "logic_smartcard.h"
 #include "usb_cmd_parser.h"
@@ -37,11 +41,13 @@
 #include "oled_wrapper.h"
 #include "logic_eeprom.h"
 #include "hid_defines.h"
+#include "loop_profiler.h"
 #include "mini_inputs.h"
 #include <avr/eeprom.h>
 #include "mooltipass.h"
 #include "mini_leds.h"
 #include "node_mgmt.h"
+#include "flash_test.h"
 #include "flash_mem.h"
 #include <string.h>
 #include <ctype.h>
@@ -58,6 +64,18 @@ uint8_t mediaFlashImportApproved = FALSE;
 uint16_t mediaFlashImportOffset;
 // Media flash import temp page
 uint16_t mediaFlashImportPage;
+// Media flash import: flash internal buffer being filled, the other one may be programmed
+uint8_t mediaFlashImportBuffer;
+// Media flash streamed import: next expected sequence number
+uint16_t mediaFlashImportNextSeq;
+// Media flash streamed import: in order packets received since the last ack
+uint8_t mediaFlashImportUnacked;
+// Media flash streamed import: set when a gap was NAKed, until the missing packet arrives
+uint8_t mediaFlashImportNakSent;
+// Media flash streamed import: set when a duplicate was acked, until the next in order packet arrives
+uint8_t mediaFlashImportDupAckSent;
+// Media flash import: set once a streamed packet was received, END then checks the packet count
+uint8_t mediaFlashImportStreamed;
 /* External var, addr of bottom of stack (usually located at end of RAM)*/
 extern uint8_t __stack;
 /* External var, end of known static RAM (to be filled by linker) */
@@ -80,6 +98,279 @@ RET_TYPE usbCancelRequestReceived(void)
     return RETURN_NOK;
 }
 
+/*! \fn     usbProcessStatusCommand(usbMsg_t* msg, uint8_t* plugin_return_value)
+*   \brief  Process a command only answered by a status byte, may be part of a batch
+*   \param  msg                 The command
+*   \param  plugin_return_value Where to store the status byte
+*   \return RETURN_NOK if the command isn't one of these
+*/
+static RET_TYPE usbProcessStatusCommand(usbMsg_t* msg, uint8_t* plugin_return_value)
+{
+    // Error by default
+    *plugin_return_value = PLUGIN_BYTE_ERROR;
+    
+    switch(msg->cmd)
+    {
+        // Enable / disable unsolicited socket reports
+        case CMD_SET_SOCKET_REPORTS :
+        {
+            if (msg->body.data[0] != FALSE)
+            {
+                enableSocketReports(TRUE);
+            }
+            else
+            {
+                enableSocketReports(FALSE);
+            }
+            *plugin_return_value = PLUGIN_BYTE_OK;
+            break;
+        }
+        
+        // Acknowledge the socket reports up to a given sequence number
+        case CMD_ACK_SOCKET_REPORTS :
+        {
+            acknowledgeSocketReports((uint16_t)msg->body.data[0] | ((uint16_t)msg->body.data[1] << 8));
+            *plugin_return_value = PLUGIN_BYTE_OK;
+            break;
+        }
+        
+        // Programming done!
+        case CMD_PROG_DONE:
+        {
+            if (msg->body.data[0] < NB_PROG_RIGS)
+            {
+                programming_success(msg->body.data[0]);
+                *plugin_return_value = PLUGIN_BYTE_OK;
+            }
+            break;
+        }
+        
+        // Programming done!
+        case CMD_PROG_FAILURE:
+        {
+            if (msg->body.data[0] < NB_PROG_RIGS)
+            {
+                programming_failure(msg->body.data[0]);
+                *plugin_return_value = PLUGIN_BYTE_OK;
+            }
+            break;
+        }
+        
+        // Programming results for several sockets: 32 bits socket mask, then one result byte per socket in the mask
+        case CMD_PROG_RESULTS:
+        {
+            uint32_t socket_mask = (uint32_t)msg->body.data[0] | ((uint32_t)msg->body.data[1] << 8) | ((uint32_t)msg->body.data[2] << 16) | ((uint32_t)msg->body.data[3] << 24);
+            uint8_t result_index = sizeof(socket_mask);
+            
+            // Check the mask and that we have all the results before changing anything
+            if ((socket_mask >> NB_PROG_RIGS) != 0)
+            {
+                break;
+            }
+            for (uint8_t i = 0; i < NB_PROG_RIGS; i++)
+            {
+                if (socket_mask & ((uint32_t)1 << i))
+                {
+                    result_index++;
+                }
+            }
+            if (result_index > msg->len)
+            {
+                break;
+            }
+            
+            // Extender writes are only flushed once all the sockets are updated
+            result_index = sizeof(socket_mask);
+            for (uint8_t i = 0; i < NB_PROG_RIGS; i++)
+            {
+                if (socket_mask & ((uint32_t)1 << i))
+                {
+                    if (msg->body.data[result_index++] == PROG_RESULT_SUCCESS)
+                    {
+                        programming_success(i);
+                    }
+                    else
+                    {
+                        programming_failure(i);
+                    }
+                }
+            }
+            *plugin_return_value = PLUGIN_BYTE_OK;
+            break;
+        }
+        
+        // Display lines
+        case CMD_DISPLAY_LINE1:
+        {
+            *plugin_return_value = PLUGIN_BYTE_OK;
+            miniOledDrawRectangle(0, 0, SSD1305_OLED_WIDTH, 10, FALSE);
+            miniOledPutstrXY(0, THREE_LINE_TEXT_FIRST_POS, OLED_LEFT, (char*)msg->body.data);
+            break;
+        }
+        
+        // Display lines
+        case CMD_DISPLAY_LINE2:
+        {
+            *plugin_return_value = PLUGIN_BYTE_OK;
+            miniOledDrawRectangle(0, 10, SSD1305_OLED_WIDTH, 11, FALSE);
+            miniOledPutstrXY(0, THREE_LINE_TEXT_SECOND_POS, OLED_LEFT, (char*)msg->body.data);
+            break;
+        }
+        
+        // Display lines
+        case CMD_DISPLAY_LINE3:
+        {
+            *plugin_return_value = PLUGIN_BYTE_OK;
+            miniOledDrawRectangle(0, 21, SSD1305_OLED_WIDTH, 11, FALSE);
+            miniOledPutstrXY(0, THREE_LINE_TEXT_THIRD_POS, OLED_LEFT, (char*)msg->body.data);
+            break;
+        }
+        
+        default :   return RETURN_NOK;
+    }
+    return RETURN_OK;
+}
+
+/*! \fn     usbProcessBatch(usbMsg_t* msg)
+*   \brief  Process the status commands packed in a CMD_BATCH packet
+*   \param  msg     The CMD_BATCH packet, made of len/cmd/payload sub commands
+*/
+static void usbProcessBatch(usbMsg_t* msg)
+{
+    uint8_t sub_return_values[PACKET_EXPORT_SIZE/HID_DATA_START];
+    uint8_t batch_len = msg->len;
+    uint8_t nb_sub_commands = 0;
+    uint8_t offset = 0;
+    usbMsg_t sub_msg;
+    
+    if (batch_len > PACKET_EXPORT_SIZE)
+    {
+        batch_len = PACKET_EXPORT_SIZE;
+    }
+    
+    // Sub commands start with their len & cmd, a null cmd ends the batch
+    while ((offset + HID_DATA_START <= batch_len) && (msg->body.data[offset+1] != 0))
+    {
+        uint8_t sub_len = msg->body.data[offset];
+        
+        if (offset + HID_DATA_START + sub_len > batch_len)
+        {
+            break;
+        }
+        
+        // Copied to a zero filled buffer as display payloads are used as null terminated strings
+        memset(&sub_msg, 0x00, sizeof(sub_msg));
+        memcpy(&sub_msg, &msg->body.data[offset], HID_DATA_START + sub_len);
+        usbProcessStatusCommand(&sub_msg, &sub_return_values[nb_sub_commands++]);
+        offset += HID_DATA_START + sub_len;
+    }
+    
+    // One status byte per sub command
+    usbSendMessage(CMD_BATCH, nb_sub_commands, sub_return_values);
+}
+
+/*! \fn     mediaFlashImportFlushPage(void)
+*   \brief  Start programming the filled buffer to the current import page, then switch buffers
+*/
+static void mediaFlashImportFlushPage(void)
+{
+    flashStartBufferToPage(mediaFlashImportBuffer, mediaFlashImportPage);
+    mediaFlashImportBuffer = (mediaFlashImportBuffer + 1) % FLASH_NB_BUFFERS;
+    mediaFlashImportOffset = 0;
+    mediaFlashImportPage++;
+}
+
+/*! \fn     usbSendMediaStreamStatus(uint8_t status)
+*   \brief  Answer a streamed media import with a status and the next expected sequence number
+*   \param  status  MEDIA_STREAM_ACK, MEDIA_STREAM_NAK or MEDIA_STREAM_ERROR
+*/
+static void usbSendMediaStreamStatus(uint8_t status)
+{
+    uint8_t answer[3] = {status, (uint8_t)mediaFlashImportNextSeq, (uint8_t)(mediaFlashImportNextSeq >> 8)};
+    
+    mediaFlashImportUnacked = 0;
+    usbSendMessage(CMD_IMPORT_MEDIA_STREAM, sizeof(answer), answer);
+}
+
+/*! \fn     usbProcessMediaStreamPacket(usbMsg_t* msg)
+*   \brief  Process a streamed media import packet
+*   \param  msg     The packet: 16 bits sequence number then the data to append
+*   \note   The host may have several packets in flight: in order packets are cumulatively acked
+*           every MEDIA_STREAM_ACK_INTERVAL packets, the first packet after a gap is NAKed with the
+*           sequence number to resume from and the following ones are dropped until it arrives.
+*           The first retransmitted packet we already have is answered by an ack, in case ours was lost.
+*           Unlike CMD_IMPORT_MEDIA, payloads may cross page boundaries.
+*/
+static void usbProcessMediaStreamPacket(usbMsg_t* msg)
+{
+    uint16_t seq = (uint16_t)msg->body.data[0] | ((uint16_t)msg->body.data[1] << 8);
+    uint8_t* datap = &msg->body.data[MEDIA_STREAM_HEADER_SIZE];
+    uint8_t datalen = msg->len - MEDIA_STREAM_HEADER_SIZE;
+    uint8_t chunk_len;
+    
+    mediaFlashImportStreamed = TRUE;
+    if ((mediaFlashImportApproved == FALSE) || (msg->len < MEDIA_STREAM_HEADER_SIZE) || (msg->len > PACKET_EXPORT_SIZE))
+    {
+        mediaFlashImportApproved = FALSE;
+        usbSendMediaStreamStatus(MEDIA_STREAM_ERROR);
+        return;
+    }
+    
+    // Retransmitted packet we already have: our ack was lost or late, ack once so the host moves its window
+    if ((int16_t)(seq - mediaFlashImportNextSeq) < 0)
+    {
+        if (mediaFlashImportDupAckSent == FALSE)
+        {
+            mediaFlashImportDupAckSent = TRUE;
+            usbSendMediaStreamStatus(MEDIA_STREAM_ACK);
+        }
+        return;
+    }
+    
+    // Gap: ask for a retransmission once, drop everything until it arrives
+    if (seq != mediaFlashImportNextSeq)
+    {
+        if (mediaFlashImportNakSent == FALSE)
+        {
+            mediaFlashImportNakSent = TRUE;
+            usbSendMediaStreamStatus(MEDIA_STREAM_NAK);
+        }
+        return;
+    }
+    
+    // Append the data, flushing the buffer each time a page is filled
+    while (datalen != 0)
+    {
+        if (mediaFlashImportPage >= GRAPHIC_ZONE_PAGE_END)
+        {
+            mediaFlashImportApproved = FALSE;
+            usbSendMediaStreamStatus(MEDIA_STREAM_ERROR);
+            return;
+        }
+        chunk_len = datalen;
+        if (mediaFlashImportOffset + chunk_len > BYTES_PER_PAGE)
+        {
+            chunk_len = BYTES_PER_PAGE - mediaFlashImportOffset;
+        }
+        flashWriteBufferNoWait(mediaFlashImportBuffer, datap, mediaFlashImportOffset, chunk_len);
+        mediaFlashImportOffset += chunk_len;
+        datap += chunk_len;
+        datalen -= chunk_len;
+        if (mediaFlashImportOffset == BYTES_PER_PAGE)
+        {
+            mediaFlashImportFlushPage();
+        }
+    }
+    
+    mediaFlashImportNakSent = FALSE;
+    mediaFlashImportDupAckSent = FALSE;
+    mediaFlashImportNextSeq++;
+    if (++mediaFlashImportUnacked >= MEDIA_STREAM_ACK_INTERVAL)
+    {
+        usbSendMediaStreamStatus(MEDIA_STREAM_ACK);
+    }
+}
+
 /*! \fn     usbProcessIncoming(uint8_t caller_id)
 *   \brief  Process a possible incoming USB packet
 *   \param  caller_id   UID of the calling function
@@ -148,7 +439,13 @@ void usbProcessIncoming(uint8_t caller_id)
             // Set default addresses
             mediaFlashImportPage = GRAPHIC_ZONE_PAGE_START;
             plugin_return_value = PLUGIN_BYTE_OK;
+            mediaFlashImportBuffer = FLASH_BUFFER_1;
             mediaFlashImportApproved = TRUE;
+            mediaFlashImportNakSent = FALSE;
+            mediaFlashImportDupAckSent = FALSE;
+            mediaFlashImportStreamed = FALSE;
+            mediaFlashImportUnacked = 0;
+            mediaFlashImportNextSeq = 0;
             mediaFlashImportOffset = 0;
             break;
         }
@@ -164,103 +461,167 @@ void usbProcessIncoming(uint8_t caller_id)
             }
             else
             {
-                flashWriteBuffer(msg->body.data, mediaFlashImportOffset, datalen);
+                flashWriteBufferNoWait(mediaFlashImportBuffer, msg->body.data, mediaFlashImportOffset, datalen);
                 mediaFlashImportOffset+= datalen;
 
-                // If we just filled a page, flush it to the page
+                // If we just filled a page, flush it to the page while the other buffer gets filled
                 if (mediaFlashImportOffset == BYTES_PER_PAGE)
                 {
-                    flashWriteBufferToPage(mediaFlashImportPage);
-                    mediaFlashImportOffset = 0;
-                    mediaFlashImportPage++;
+                    mediaFlashImportFlushPage();
                 }
                 plugin_return_value = PLUGIN_BYTE_OK;
             }
             break;
         }
 
-        // end media flash import
+        // import media flash contents, several packets in flight
+        case CMD_IMPORT_MEDIA_STREAM :
+        {
+            usbProcessMediaStreamPacket(msg);
+            return;
+        }
+
+        // CRC32 of a flash page range, to check an import without reading it back: 16 bits start page, 16 bits number of pages (at most FLASH_CRC32_MAX_PAGES), optional 32 bits CRC of the previous range
+        case CMD_GET_FLASH_CRC32 :
+        {
+            uint16_t start_page = (uint16_t)msg->body.data[0] | ((uint16_t)msg->body.data[1] << 8);
+            uint16_t nb_pages = (uint16_t)msg->body.data[2] | ((uint16_t)msg->body.data[3] << 8);
+            uint32_t crc = 0;
+            
+            if (datalen >= 8)
+            {
+                memcpy(&crc, &msg->body.data[4], sizeof(crc));
+            }
+            if ((datalen < 4) || (start_page >= PAGE_COUNT) || (nb_pages > PAGE_COUNT - start_page) || (nb_pages > FLASH_CRC32_MAX_PAGES))
+            {
+                break;
+            }
+            crc = flashCrc32(start_page, nb_pages, crc);
+            usbSendMessage(CMD_GET_FLASH_CRC32, sizeof(crc), &crc);
+            return;
+        }
+
+        // end media flash import, a streamed import may also send the number of packets it sent
         case CMD_IMPORT_MEDIA_END :
         {
             if ((mediaFlashImportApproved == TRUE) && (mediaFlashImportOffset != 0))
             {
-                flashWriteBufferToPage(mediaFlashImportPage);
+                mediaFlashImportFlushPage();
+            }
+            waitForFlash();
+            if ((mediaFlashImportStreamed == FALSE) || ((mediaFlashImportApproved == TRUE) && ((datalen < MEDIA_STREAM_HEADER_SIZE) || (((uint16_t)msg->body.data[0] | ((uint16_t)msg->body.data[1] << 8)) == mediaFlashImportNextSeq))))
+            {
+                plugin_return_value = PLUGIN_BYTE_OK;
             }
-            plugin_return_value = PLUGIN_BYTE_OK;
             mediaFlashImportApproved = FALSE;
+            mediaFlashImportStreamed = FALSE;
             break;
         }
         
         // Get button pressed array
         case CMD_BUTTON_PRESSED :
         {
-            uint8_t temp_array[9];
+            uint8_t temp_array[NB_PROG_RIGS];
             get_and_clear_button_pressed_return(temp_array);
             usbSendMessage(CMD_BUTTON_PRESSED, sizeof(temp_array), temp_array);
             return;
         }
         
-        // Get 32 random bytes
-        case CMD_GET_RANDOM_NUMBER :
+        // Get number of issued, suppressed & failed extender output writes
+        case CMD_GET_IO_WRITE_STATS :
         {
-            uint8_t randomBytes[32];
-            fillArrayWithRandomBytes(randomBytes, 32);
-            usbSendMessage(CMD_GET_RANDOM_NUMBER, 32, randomBytes);
+            uint32_t write_counters[3];
+            get_prog_rig_output_write_counters(&write_counters[0], &write_counters[1], &write_counters[2]);
+            usbSendMessage(CMD_GET_IO_WRITE_STATS, sizeof(write_counters), write_counters);
             return;
-        }  
+        }
         
-        // Get number of available random bytes
-        case CMD_GET_NB_RNG_B:
+        // Get the statistics of the sockets starting at a given ID
+        case CMD_GET_SOCKET_STATS :
         {
-            uint8_t available_bytes = rngGetBufferCount()*4;
-            usbSendMessage(CMD_GET_NB_RNG_B, 1, &available_bytes);
+            socketStats_t stats[SOCKET_STATS_PER_PACKET];
+            uint8_t nb_sockets = 0;
+            
+            for (uint8_t i = msg->body.data[0]; (i < NB_PROG_RIGS) && (nb_sockets < SOCKET_STATS_PER_PACKET); i++)
+            {
+                getSocketStats(i, &stats[nb_sockets++]);
+            }
+            usbSendMessage(CMD_GET_SOCKET_STATS, nb_sockets * sizeof(socketStats_t), stats);
             return;
         }
         
-        // Programming done!
-        case CMD_PROG_DONE:
+#ifdef ENABLE_SOCKET_LATENCY
+        // Get the latency histograms of a socket, reset them if the second byte is set
+        case CMD_GET_LATENCY_HISTO :
         {
-            programming_success(msg->body.data[0]);
-            plugin_return_value = PLUGIN_BYTE_OK;
-            break;
+            uint8_t histograms[LATENCY_HISTOGRAMS_SIZE];
+            
+            if (msg->body.data[0] >= NB_PROG_RIGS)
+            {
+                break;
+            }
+            getAndResetSocketLatencyHistograms(msg->body.data[0], histograms, msg->body.data[1]);
+            usbSendMessage(CMD_GET_LATENCY_HISTO, sizeof(histograms), histograms);
+            return;
         }
+#endif
         
-        // Programming done!
-        case CMD_PROG_FAILURE:
+#ifdef ENABLE_FLASH_BENCHMARK
+        // Flash benchmark: one message per SPI rate and operation, then a one byte message. Refused while sockets are programming
+        case CMD_FLASH_BENCHMARK :
         {
-            programming_failure(msg->body.data[0]);
-            plugin_return_value = PLUGIN_BYTE_OK;
+            if (are_all_prog_rigs_idle() == TRUE)
+            {
+                flashBenchmark();
+                plugin_return_value = PLUGIN_BYTE_OK;
+            }
             break;
         }
+#endif
         
-        // Display lines
-        case CMD_DISPLAY_LINE1:
+#ifdef ENABLE_LOOP_PROFILER
+        // Get the main loop phases durations, reset them if the first byte is set
+        case CMD_GET_LOOP_PROFILE :
         {
-            plugin_return_value = PLUGIN_BYTE_OK;
-            miniOledDrawRectangle(0, 0, SSD1305_OLED_WIDTH, 10, FALSE);
-            miniOledPutstrXY(0, THREE_LINE_TEXT_FIRST_POS, OLED_LEFT, (char*)msg->body.data);
-            break;
+            loopPhaseReport_t reports[NB_LOOP_PHASES];
+            getAndResetLoopProfile(reports, msg->body.data[0]);
+            usbSendMessage(CMD_GET_LOOP_PROFILE, sizeof(reports), reports);
+            return;
         }
+#endif
         
-        // Display lines
-        case CMD_DISPLAY_LINE2:
+        // Get 32 random bytes
+        case CMD_GET_RANDOM_NUMBER :
         {
-            plugin_return_value = PLUGIN_BYTE_OK;
-            miniOledDrawRectangle(0, 10, SSD1305_OLED_WIDTH, 11, FALSE);
-            miniOledPutstrXY(0, THREE_LINE_TEXT_SECOND_POS, OLED_LEFT, (char*)msg->body.data);
-            break;
+            uint8_t randomBytes[32];
+            fillArrayWithRandomBytes(randomBytes, 32);
+            usbSendMessage(CMD_GET_RANDOM_NUMBER, 32, randomBytes);
+            return;
+        }  
+        
+        // Get number of available random bytes
+        case CMD_GET_NB_RNG_B:
+        {
+            uint8_t available_bytes = rngGetBufferCount()*4;
+            usbSendMessage(CMD_GET_NB_RNG_B, 1, &available_bytes);
+            return;
         }
         
-        // Display lines
-        case CMD_DISPLAY_LINE3:
+        // Several status commands in one packet
+        case CMD_BATCH :
         {
-            plugin_return_value = PLUGIN_BYTE_OK;
-            miniOledDrawRectangle(0, 21, SSD1305_OLED_WIDTH, 11, FALSE);
-            miniOledPutstrXY(0, THREE_LINE_TEXT_THIRD_POS, OLED_LEFT, (char*)msg->body.data);
+            usbProcessBatch(msg);
+            return;
+        }
+        
+        default :
+        {
+            if (usbProcessStatusCommand(msg, &plugin_return_value) != RETURN_OK)
+            {
+                return;
+            }
             break;
         }
-
-        default :   return;
     }
     
     // Return an answer that was defined before calling break
@@ -17,6 +17,18 @@
 #define CMD_DISPLAY_LINE1       0x84
 #define CMD_DISPLAY_LINE2       0x85
 #define CMD_DISPLAY_LINE3       0x86
+#define CMD_GET_IO_WRITE_STATS  0x87
+#define CMD_SOCKET_REPORT       0x88
+#define CMD_SET_SOCKET_REPORTS  0x89
+#define CMD_ACK_SOCKET_REPORTS  0x8A
+#define CMD_BATCH               0x8B
+#define CMD_PROG_RESULTS        0x8C
+#define CMD_GET_SOCKET_STATS    0x8D
+#define CMD_GET_LATENCY_HISTO   0x8E
+#define CMD_GET_LOOP_PROFILE    0x8F
+#define CMD_IMPORT_MEDIA_STREAM 0x90
+#define CMD_GET_FLASH_CRC32     0x91
+#define CMD_FLASH_BENCHMARK     0x92
 
 // From here the commands are used
 #define CMD_DEBUG               0xA0
@@ -91,6 +103,20 @@
 #define HID_TYPE_FIELD      0x01
 #define HID_DATA_START      0x02
 
+/* CMD_PROG_RESULTS per socket result */
+#define PROG_RESULT_FAILURE 0x00
+#define PROG_RESULT_SUCCESS 0x01
+
+/* CMD_IMPORT_MEDIA_STREAM: 16 bits sequence number then payload, answered by a status byte and the next expected sequence number */
+#define MEDIA_STREAM_HEADER_SIZE    2
+#define MEDIA_STREAM_ACK_INTERVAL   4       // In order packets between two cumulative acks, host window should be larger
+#define MEDIA_STREAM_ERROR          0x00
+#define MEDIA_STREAM_ACK            0x01
+#define MEDIA_STREAM_NAK            0x02
+
+/* CMD_GET_FLASH_CRC32: pages per request, a few ms of USB task. Larger ranges are chained by the host passing the previous CRC */
+#define FLASH_CRC32_MAX_PAGES       4
+
 /* Packet answers */
 #define PLUGIN_BYTE_ERROR   0x00
 #define PLUGIN_BYTE_OK      0x01
@@ -20,9 +20,17 @@
 /*! \file   utils.c
 *   \brief  Useful functions
 */
+#include <avr/pgmspace.h>
 #include "mooltipass.h"
 #include "utils.h"
 
+// Nibble lookup table for the reflected CRC32 polynomial 0xEDB88320
+static const uint32_t crc32_nibble_table[16] PROGMEM =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
 
 /*! \fn     swap16(uint16_t val)
 *   \brief  Swap low and high bytes
@@ -34,6 +42,20 @@ uint16_t swap16(uint16_t val)
     return ((val << 8) | (uint8_t)(val >> 8));
 }
 
+/*! \fn     crc32Update(uint32_t crc, uint8_t data)
+*   \brief  Add a byte to a CRC32 (IEEE 802.3, same as zlib)
+*   \param  crc     The current CRC, start with 0xFFFFFFFF and invert the final value
+*   \param  data    The byte
+*   \return The updated CRC
+*/
+uint32_t crc32Update(uint32_t crc, uint8_t data)
+{
+    crc ^= data;
+    crc = (crc >> 4) ^ pgm_read_dword(&crc32_nibble_table[crc & 0x0F]);
+    crc = (crc >> 4) ^ pgm_read_dword(&crc32_nibble_table[crc & 0x0F]);
+    return crc;
+}
+
 /*! \fn     numchar_to_char(unsigned char c)
 *   \brief  Convert a char value (0 to 9) to be displayed
 *   \param  c   The char
@@ -327,15 +327,50 @@ typedef int8_t RET_TYPE;
 /**************** FEATURE SELECTION ****************/
 // Used for normal browser plugin communications
 #define USB_FEATURE_PLUGIN_COMMS
+// Main loop phases duration profiling
+#define ENABLE_LOOP_PROFILER
+// Per socket latency histograms, 51 bytes of RAM per socket
+//#define ENABLE_SOCKET_LATENCY
+// Flash throughput benchmark over USB, erases the last flash sector
+//#define ENABLE_FLASH_BENCHMARK
 
 /**************** DEFINES PORTS ****************/
 // I2C IOs
 #define PORTID_I2C_SCL  PORTD0
-#define PORT_I2C_SCL    PORTD
-#define DDR_I2C_SCL     DDRD
 #define PORTID_I2C_SDA  PORTD1
-#define PORT_I2C_SDA    PORTD
-#define DDR_I2C_SDA     DDRD
+#ifndef MOOLTIPASS_SIMULATOR
+    #define PORT_I2C_SCL    PORTD
+    #define DDR_I2C_SCL     DDRD
+    #define PIN_I2C_SCL     PIND
+    #define PORT_I2C_SDA    PORTD
+    #define DDR_I2C_SDA     DDRD
+    #define PIN_I2C_SDA     PIND
+#else
+    #define PORT_I2C_SCL    (*simI2cLineReg(&PORTD))        // I2C bus emulator, see SIM/sim_i2c_bus.c
+    #define DDR_I2C_SCL     (*simI2cLineReg(&DDRD))
+    #define PIN_I2C_SCL     (*simI2cLineReg(&PIND))
+    #define PORT_I2C_SDA    (*simI2cLineReg(&PORTD))
+    #define DDR_I2C_SDA     (*simI2cLineReg(&DDRD))
+    #define PIN_I2C_SDA     (*simI2cLineReg(&PIND))
+#endif
+// Bit banged I2C IOs, for the extenders of the third socket bank (free smartcard SPI pins)
+#define PORTID_SOFT_I2C_SCL PORTB1
+#define PORTID_SOFT_I2C_SDA PORTB0
+#ifndef MOOLTIPASS_SIMULATOR
+    #define PORT_SOFT_I2C_SCL   PORTB
+    #define DDR_SOFT_I2C_SCL    DDRB
+    #define PIN_SOFT_I2C_SCL    PINB
+    #define PORT_SOFT_I2C_SDA   PORTB
+    #define DDR_SOFT_I2C_SDA    DDRB
+    #define PIN_SOFT_I2C_SDA    PINB
+#else
+    #define PORT_SOFT_I2C_SCL   (*simI2cLineReg(&PORTB))    // I2C bus emulator, see SIM/sim_i2c_bus.c
+    #define DDR_SOFT_I2C_SCL    (*simI2cLineReg(&DDRB))
+    #define PIN_SOFT_I2C_SCL    (*simI2cLineReg(&PINB))
+    #define PORT_SOFT_I2C_SDA   (*simI2cLineReg(&PORTB))
+    #define DDR_SOFT_I2C_SDA    (*simI2cLineReg(&DDRB))
+    #define PIN_SOFT_I2C_SDA    (*simI2cLineReg(&PINB))
+#endif
 // SPIs
 #define SPI_SMARTCARD   SPI_NATIVE
 #define SPI_FLASH       SPI_USART
@@ -353,7 +388,11 @@ typedef int8_t RET_TYPE;
 #define MISO_SPI_USART  PORTD2
 // Slave Select Flash
 #define PORTID_FLASH_nS PORTB4
-#define PORT_FLASH_nS   PORTB
+#ifndef MOOLTIPASS_SIMULATOR
+    #define PORT_FLASH_nS   PORTB
+#else
+    #define PORT_FLASH_nS   (*simFlashChipSelectPort())     // DataFlash emulator, see SIM/sim_at45.c
+#endif
 #define DDR_FLASH_nS    DDRB
 // Detect smart card
 #define PORTID_SC_DET   PORTC7
@@ -22,137 +22,307 @@
  *  Copyright [2014] [Mathieu Stephan]
  */
 #include "defines.h"
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+#include <util/delay.h>
 #include <avr/io.h>
 #include "i2c.h"
 
+// Transaction queue: head is only written by the main loop, tail only by the TWI interrupt
+static i2cTransaction_t i2c_queue[I2C_QUEUE_SIZE];
+static volatile uint8_t i2c_queue_head;
+static volatile uint8_t i2c_queue_tail;
+// Set while the TWI interrupt is processing the queue
+static volatile uint8_t i2c_engine_busy = FALSE;
+// Set once the register byte of a write transaction has been sent
+static volatile uint8_t i2c_reg_sent;
+// Last command byte sent to each device, only used by the TWI interrupt
+static uint8_t i2c_pointer_cache_addr[I2C_DEVICE_TABLE_SIZE];
+static uint8_t i2c_pointer_cache_reg[I2C_DEVICE_TABLE_SIZE];
+// Bit rate register value for each device, 0 for the default one
+static uint8_t i2c_device_twbr[I2C_DEVICE_TABLE_SIZE];
+// Number of ms since the TWI interrupt last fired while busy
+static volatile uint8_t i2c_watchdog_ms;
+// Number of transactions aborted on timeout
+static volatile uint16_t i2c_nb_timeouts;
+// Called from interrupt context when a transaction having a status pointer completes
+static i2cCallback_t i2c_completion_callback;
 
-/*! \fn     waitForTwintFlag(void)
-*   \brief  Wait for TWINT flag, indicating that current task is finished
+
+/*! \fn     setBitRateForDevice(uint8_t addr)
+*   \brief  Set the TWI bit rate to the one selected for a given device
+*   \param  addr        The chip address
 */
-static inline void waitForTwintFlag(void)
+static inline void setBitRateForDevice(uint8_t addr)
 {
-    while(!(TWCR & (1<<TWINT)));
+    uint8_t twbr = i2c_device_twbr[I2C_DEVICE_INDEX(addr)];
+
+    if (twbr == 0)
+    {
+        twbr = I2C_DEFAULT_TWBR;
+    }
+    TWBR = twbr;
 }
 
-/*! \fn     isStartSendingOk(void)
-*   \brief  Know if we successfully generated the start condition
-*   \return RETURN_OK if everything is alright
+/*! \fn     i2cBusRecovery(void)
+*   \brief  Clock SCL until a slave stuck in a transfer releases SDA, then generate a STOP
+*   \note   TWI controller is left disabled
 */
-static inline RET_TYPE isStartSendingOk(void)
+static void i2cBusRecovery(void)
 {
-    if ((TWSR & 0xF8) == I2C_START)
-    {
-        return RETURN_OK;
-    }
-    else
+    // Give the pins back to the GPIO logic: open drain, released lines pulled up
+    TWCR = 0;
+    PORT_I2C_SCL |= (1 << PORTID_I2C_SCL);
+    PORT_I2C_SDA |= (1 << PORTID_I2C_SDA);
+    DDR_I2C_SCL &= ~(1 << PORTID_I2C_SCL);
+    DDR_I2C_SDA &= ~(1 << PORTID_I2C_SDA);
+
+    for (uint8_t i = 0; (i < 9) && ((PIN_I2C_SDA & (1 << PORTID_I2C_SDA)) == 0); i++)
     {
-        return RETURN_NOK;
+        PORT_I2C_SCL &= ~(1 << PORTID_I2C_SCL);
+        DDR_I2C_SCL |= (1 << PORTID_I2C_SCL);
+        _delay_us(5);
+        DDR_I2C_SCL &= ~(1 << PORTID_I2C_SCL);
+        PORT_I2C_SCL |= (1 << PORTID_I2C_SCL);
+        _delay_us(5);
     }
+
+    // STOP: SDA rising while SCL is high
+    PORT_I2C_SDA &= ~(1 << PORTID_I2C_SDA);
+    DDR_I2C_SDA |= (1 << PORTID_I2C_SDA);
+    _delay_us(5);
+    DDR_I2C_SDA &= ~(1 << PORTID_I2C_SDA);
+    PORT_I2C_SDA |= (1 << PORTID_I2C_SDA);
+    _delay_us(5);
 }
 
-/*! \fn     isRestartSendingOk(void)
-*   \brief  Know if we successfully generated the restart condition
-*   \return RETURN_OK if everything is alright
+
+/*! \fn     completeCurrentTransaction(RET_TYPE status)
+*   \brief  Signal the end of the current transaction, start the next one if any
+*   \param  status      Status to report to the submitter
 */
-static inline RET_TYPE isRestartSendingOk(void)
+static inline void completeCurrentTransaction(RET_TYPE status)
 {
-    if ((TWSR & 0xF8) == I2C_RSTART)
+    i2cTransaction_t* cur_transaction = &i2c_queue[i2c_queue_tail];
+
+    // We don't know what the device received, forget its command byte
+    if (status != RETURN_OK)
     {
-        return RETURN_OK;
+        i2c_pointer_cache_addr[I2C_DEVICE_INDEX(cur_transaction->addr)] = 0;
     }
-    else
+    if (cur_transaction->status != 0)
     {
-        return RETURN_NOK;
+        *cur_transaction->status = status;
+        if (i2c_completion_callback != 0)
+        {
+            i2c_completion_callback();
+        }
     }
-}
+    i2c_queue_tail = (i2c_queue_tail + 1) & I2C_QUEUE_MASK;
+    i2c_reg_sent = FALSE;
 
-/*! \fn     isSlawSendingOk(void)
-*   \brief  Know if we successfully sent the addr byte
-*   \return RETURN_OK if everything is alright
-*/
-static inline RET_TYPE isSlawSendingOk(void)
-{
-    if ((TWSR & 0xF8) == I2C_SLA_ACK)
+    if (i2c_queue_tail != i2c_queue_head)
     {
-        return RETURN_OK;
+        // Stop followed by a start condition for the next transaction
+        setBitRateForDevice(i2c_queue[i2c_queue_tail].addr);
+        stop_start_condition_isr();
     }
     else
     {
-        return RETURN_NOK;
+        stop_condition();
+        i2c_engine_busy = FALSE;
     }
 }
 
-/*! \fn     isSlarSendingOk(void)
-*   \brief  Know if we successfully sent the addr byte (reading mode)
-*   \return RETURN_OK if everything is alright
+/*! \fn     ISR(TWI_vect)
+*   \brief  TWI interrupt, walks through the current transaction
 */
-static inline RET_TYPE isSlarSendingOk(void)
+ISR(TWI_vect)
 {
-    if ((TWSR & 0xF8) == I2C_SLAR_ACK)
-    {
-        return RETURN_OK;
-    }
-    else
+    i2cTransaction_t* cur_transaction = &i2c_queue[i2c_queue_tail];
+
+    i2c_watchdog_ms = 0;
+
+    switch(TWSR & 0xF8)
     {
-        return RETURN_NOK;
+        case I2C_START:
+        {
+            uint8_t cache_index = I2C_DEVICE_INDEX(cur_transaction->addr);
+
+            // Device command byte already pointing to our register: skip the write phase
+            if ((cur_transaction->flags & I2C_FLAG_CACHED_POINTER) && (i2c_pointer_cache_addr[cache_index] == cur_transaction->addr) && (i2c_pointer_cache_reg[cache_index] == cur_transaction->reg))
+            {
+                TWDR = cur_transaction->addr | 0x01;
+            }
+            else
+            {
+                TWDR = cur_transaction->addr;
+            }
+            clear_twint_flag_isr();
+            break;
+        }
+        case I2C_RSTART:
+        {
+            TWDR = cur_transaction->addr | 0x01;
+            clear_twint_flag_isr();
+            break;
+        }
+        case I2C_SLA_ACK:
+        {
+            TWDR = cur_transaction->reg;
+            clear_twint_flag_isr();
+            break;
+        }
+        case I2C_DATA_ACK:
+        {
+            if (i2c_reg_sent == FALSE)
+            {
+                // The device command byte now points to our register
+                uint8_t cache_index = I2C_DEVICE_INDEX(cur_transaction->addr);
+                i2c_pointer_cache_addr[cache_index] = cur_transaction->addr;
+                i2c_pointer_cache_reg[cache_index] = cur_transaction->reg;
+            }
+            if (cur_transaction->read_dest != 0)
+            {
+                // Register pointer set, restart in reading mode
+                start_condition_isr();
+            }
+            else if (i2c_reg_sent == FALSE)
+            {
+                i2c_reg_sent = TRUE;
+                TWDR = cur_transaction->data;
+                clear_twint_flag_isr();
+            }
+            else
+            {
+                completeCurrentTransaction(RETURN_OK);
+            }
+            break;
+        }
+        case I2C_SLAR_ACK:
+        {
+            // Single byte read: NACK it
+            clear_twint_flag_isr();
+            break;
+        }
+        case I2C_DATAR_NACK:
+        {
+            *cur_transaction->read_dest = TWDR;
+            completeCurrentTransaction(RETURN_OK);
+            break;
+        }
+        case I2C_SLA_NACK:
+        {
+            completeCurrentTransaction(I2C_SLA_ERROR);
+            break;
+        }
+        case I2C_DATA_NACK:
+        {
+            completeCurrentTransaction(I2C_DATA_ERROR);
+            break;
+        }
+        case I2C_SLAR_NACK:
+        {
+            completeCurrentTransaction(I2C_SLAR_ERROR);
+            break;
+        }
+        default:
+        {
+            // Arbitration lost or bus error
+            completeCurrentTransaction(I2C_START_ERROR);
+            break;
+        }
     }
 }
 
-/*! \fn     isDataSendingOk(void)
-*   \brief  Know if we successfully sent the data byte
-*   \return RETURN_OK if everything is alright
+/*! \fn     i2cQueueTransaction(uint8_t addr, uint8_t reg, uint8_t data, uint8_t flags, volatile uint8_t* read_dest, volatile RET_TYPE* status)
+*   \brief  Add a transaction to the queue, waits if the queue is full
+*   \param  addr        The chip address
+*   \param  reg         The register address
+*   \param  data        The data to write, unused for reads
+*   \param  flags       Transaction flags (I2C_FLAG_xxx)
+*   \param  read_dest   Where to store the read byte, 0 for a write
+*   \param  status      Where to store the transaction status, may be 0
 */
-static inline RET_TYPE isDataSendingOk(void)
+static void i2cQueueTransaction(uint8_t addr, uint8_t reg, uint8_t data, uint8_t flags, volatile uint8_t* read_dest, volatile RET_TYPE* status)
 {
-    if ((TWSR & 0xF8) == I2C_DATA_ACK)
+    uint8_t next_head = (i2c_queue_head + 1) & I2C_QUEUE_MASK;
+
+    // Queue full: wait for the interrupt to free a slot
+    while (next_head == i2c_queue_tail);
+
+    if (status != 0)
     {
-        return RETURN_OK;
+        *status = I2C_PENDING;
     }
-    else
+    i2c_queue[i2c_queue_head].addr = addr;
+    i2c_queue[i2c_queue_head].reg = reg;
+    i2c_queue[i2c_queue_head].data = data;
+    i2c_queue[i2c_queue_head].flags = flags;
+    i2c_queue[i2c_queue_head].read_dest = read_dest;
+    i2c_queue[i2c_queue_head].status = status;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
     {
-        return RETURN_NOK;
+        i2c_queue_head = next_head;
+        if (i2c_engine_busy == FALSE)
+        {
+            i2c_engine_busy = TRUE;
+            i2c_watchdog_ms = 0;
+            setBitRateForDevice(addr);
+            start_condition_isr();
+        }
     }
 }
 
-/*! \fn     initiateI2cWrite(uint8_t addr, uint8_t reg)
-*   \brief  Initiate a write process in the at42qt2120
+/*! \fn     i2cQueueWrite(uint8_t addr, uint8_t reg, uint8_t data, volatile RET_TYPE* status)
+*   \brief  Queue a byte write, returns before the transaction is done
 *   \param  addr        The chip address
 *   \param  reg         The register address
-*   \return RETURN_OK if everything is alright, the pb code otherwise
+*   \param  data        The data to write
+*   \param  status      Set to I2C_PENDING, then to the transaction result. May be 0
 */
-RET_TYPE initiateI2cWrite(uint8_t addr, uint8_t reg)
+void i2cQueueWrite(uint8_t addr, uint8_t reg, uint8_t data, volatile RET_TYPE* status)
 {
-    start_condition();
-    waitForTwintFlag();
-    if(isStartSendingOk() != RETURN_OK)
-    {
-        stop_condition();
-        return I2C_START_ERROR;
-    }
+    i2cQueueTransaction(addr, reg, data, 0, 0, status);
+}
 
-    TWDR = addr;
-    clear_twint_flag();
-    waitForTwintFlag();
-    if(isSlawSendingOk() != RETURN_OK)
-    {
-        stop_condition();
-        return I2C_SLA_ERROR;
-    }
+/*! \fn     i2cQueueRead(uint8_t addr, uint8_t reg, volatile uint8_t* data, volatile RET_TYPE* status)
+*   \brief  Queue a byte read, returns before the transaction is done
+*   \param  addr        The chip address
+*   \param  reg         The register address
+*   \param  data        Where to store the read byte
+*   \param  status      Set to I2C_PENDING, then to the transaction result
+*/
+void i2cQueueRead(uint8_t addr, uint8_t reg, volatile uint8_t* data, volatile RET_TYPE* status)
+{
+    i2cQueueTransaction(addr, reg, 0, 0, data, status);
+}
 
-    TWDR = reg;
-    clear_twint_flag();
-    waitForTwintFlag();
-    if(isDataSendingOk() != RETURN_OK)
-    {
-        stop_condition();
-        return I2C_DATA_ERROR;
-    }
+/*! \fn     i2cQueueCachedRead(uint8_t addr, uint8_t reg, volatile uint8_t* data, volatile RET_TYPE* status)
+*   \brief  Queue a byte read, skipping the command byte write if the device already points to reg
+*   \param  addr        The chip address
+*   \param  reg         The register address
+*   \param  data        Where to store the read byte
+*   \param  status      Set to I2C_PENDING, then to the transaction result
+*   \note   Only for devices retaining their command byte between transactions (PCA9554)
+*/
+void i2cQueueCachedRead(uint8_t addr, uint8_t reg, volatile uint8_t* data, volatile RET_TYPE* status)
+{
+    i2cQueueTransaction(addr, reg, 0, I2C_FLAG_CACHED_POINTER, data, status);
+}
 
-    return RETURN_OK;
+/*! \fn     isI2cIdle(void)
+*   \brief  Know if all queued transactions were processed
+*   \return TRUE if the queue is empty
+*/
+uint8_t isI2cIdle(void)
+{
+    return (i2c_engine_busy == FALSE);
 }
 
 /*! \fn     writeDataToI2C(uint8_t addr, uint8_t reg, uint8_t data)
-*   \brief  Write a byte inside the AT42QT2120
+*   \brief  Write a byte inside an I2C device, waits for completion
 *   \param  addr        The chip address
 *   \param  reg         The register address
 *   \param  data        The data to write
@@ -160,85 +330,114 @@ RET_TYPE initiateI2cWrite(uint8_t addr, uint8_t reg)
 */
 RET_TYPE writeDataToI2C(uint8_t addr, uint8_t reg, uint8_t data)
 {
-    RET_TYPE ret_val;
+    volatile RET_TYPE ret_val;
 
-    ret_val = initiateI2cWrite(addr, reg);
-    if(ret_val != RETURN_OK)
-    {
-        return ret_val;
-    }
+    i2cQueueWrite(addr, reg, data, &ret_val);
+    while (ret_val == I2C_PENDING);
+    return ret_val;
+}
 
-    TWDR = data;
-    clear_twint_flag();
-    waitForTwintFlag();
-    if(isDataSendingOk() != RETURN_OK)
-    {
-        stop_condition();
-        return I2C_DATA_ERROR;
-    }
+/*! \fn     readDataFromI2C(uint8_t addr, uint8_t reg, uint8_t* data)
+*   \brief  Read a byte from an I2C device, waits for completion
+*   \param  addr        The chip address
+*   \param  reg         The register address
+*   \param  data        uint8_t pointer in which we write the data
+*   \return RETURN_OK if everything is alright, the pb code otherwise
+*/
+RET_TYPE readDataFromI2C(uint8_t addr, uint8_t reg, uint8_t* data)
+{
+    volatile uint8_t read_val = 0;
+    volatile RET_TYPE ret_val;
 
-    stop_condition();
-    return RETURN_OK;
+    i2cQueueRead(addr, reg, &read_val, &ret_val);
+    while (ret_val == I2C_PENDING);
+    *data = read_val;
+    return ret_val;
 }
 
-/*! \fn     initiateI2cRead(uint8_t addr, uint8_t reg)
-*   \brief  Initiate a read process in the at42qt2120
+/*! \fn     readCachedDataFromI2C(uint8_t addr, uint8_t reg, uint8_t* data)
+*   \brief  Read a byte from an I2C device using the command byte cache, waits for completion
 *   \param  addr        The chip address
 *   \param  reg         The register address
+*   \param  data        uint8_t pointer in which we write the data
 *   \return RETURN_OK if everything is alright, the pb code otherwise
 */
-RET_TYPE initiateI2cRead(uint8_t addr, uint8_t reg)
+RET_TYPE readCachedDataFromI2C(uint8_t addr, uint8_t reg, uint8_t* data)
 {
-    RET_TYPE ret_val;
+    volatile uint8_t read_val = 0;
+    volatile RET_TYPE ret_val;
 
-    ret_val = initiateI2cWrite(addr, reg);
-    if(ret_val != RETURN_OK)
-    {
-        return ret_val;
-    }
+    i2cQueueCachedRead(addr, reg, &read_val, &ret_val);
+    while (ret_val == I2C_PENDING);
+    *data = read_val;
+    return ret_val;
+}
 
-    start_condition();
-    waitForTwintFlag();
-    if(isRestartSendingOk() != RETURN_OK)
+/*! \fn     i2cTick(void)
+*   \brief  Function called by interrupt every ms, aborts transactions stuck on the bus
+*/
+void i2cTick(void)
+{
+    if ((i2c_engine_busy != FALSE) && (++i2c_watchdog_ms > I2C_TRANSACTION_TIMEOUT))
     {
-        stop_condition();
-        return I2C_RSTART_ERR;
+        // Free the bus, restart the controller and move on to the next transaction
+        i2cBusRecovery();
+        i2c_nb_timeouts++;
+        i2c_watchdog_ms = 0;
+        TWCR = (1 << TWEN);
+        completeCurrentTransaction(I2C_TIMEOUT_ERROR);
     }
+}
 
-    TWDR = addr | 0x01;
-    clear_twint_flag();
-    waitForTwintFlag();
-    if(isSlarSendingOk() != RETURN_OK)
+/*! \fn     getI2cNbTimeouts(void)
+*   \brief  Get the number of transactions aborted on timeout since power up
+*   \return The number of timeouts
+*/
+uint16_t getI2cNbTimeouts(void)
+{
+    uint16_t nb_timeouts;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
     {
-        stop_condition();
-        return I2C_SLAR_ERROR;
+        nb_timeouts = i2c_nb_timeouts;
     }
-
-    return RETURN_OK;
+    return nb_timeouts;
 }
 
-/*! \fn     readDataFromI2C(uint8_t addr, uint8_t reg, uint8_t* data)
-*   \brief  Write a byte inside the AT42QT2120
-*   \param  reg         The register address
-*   \param  data        uint8_t pointer in which we write the data
-*   \return RETURN_OK if everything is alright, the pb code otherwise
+/*! \fn     i2cSelectDeviceSpeed(uint8_t addr, uint8_t reg)
+*   \brief  Find the fastest bus speed a device answers to, starting from I2C_DEFAULT_TWBR
+*   \param  addr        The chip address
+*   \param  reg         A register that can safely be read
+*   \return RETURN_OK if the device answered at one of the speeds
 */
-RET_TYPE readDataFromI2C(uint8_t addr, uint8_t reg, uint8_t* data)
+RET_TYPE i2cSelectDeviceSpeed(uint8_t addr, uint8_t reg)
 {
-    RET_TYPE ret_val;
+    const uint8_t twbr_values[] = {I2C_TWBR_400KHZ, I2C_TWBR_200KHZ, I2C_TWBR_100KHZ};
+    uint8_t dummy;
 
-    ret_val = initiateI2cRead(addr, reg);
-    if(ret_val != RETURN_OK)
+    for (uint8_t i = 0; i < sizeof(twbr_values); i++)
     {
-        return ret_val;
+        // Slower values than the default one only
+        if (twbr_values[i] < I2C_DEFAULT_TWBR)
+        {
+            continue;
+        }
+        i2c_device_twbr[I2C_DEVICE_INDEX(addr)] = twbr_values[i];
+        if (readDataFromI2C(addr, reg, &dummy) == RETURN_OK)
+        {
+            return RETURN_OK;
+        }
     }
+    return RETURN_NOK;
+}
 
-    clear_twint_flag();
-    waitForTwintFlag();
-    *data = TWDR;
-    stop_condition();
-
-    return RETURN_OK;
+/*! \fn     i2cSetCompletionCallback(i2cCallback_t callback)
+*   \brief  Set a function called from interrupt context when a transaction having a status pointer completes
+*   \param  callback    The callback, 0 for none
+*/
+void i2cSetCompletionCallback(i2cCallback_t callback)
+{
+    i2c_completion_callback = callback;
 }
 
 /*! \fn     initI2cPort()
@@ -248,9 +447,13 @@ void initI2cPort(void)
 {
     PORT_I2C_SCL |= (1 << PORTID_I2C_SCL);  // Set I2C ports as output & high
     PORT_I2C_SDA |= (1 << PORTID_I2C_SDA);  // Set I2C ports as output & high
+    if ((PIN_I2C_SDA & (1 << PORTID_I2C_SDA)) == 0)
+    {
+        i2cBusRecovery();                   // A slave is holding SDA low (quick reboot in the middle of a transfer)
+    }
     DDR_I2C_SCL |= (1 << PORTID_I2C_SCL);   // Set I2C ports as output & high
     DDR_I2C_SDA |= (1 << PORTID_I2C_SDA);   // Set I2C ports as output & high
-    //TWSR = 1;
-    TWBR = 18;                              // IC freq = 16Mhz / (16 + 2*TWBR*4^TWPS) = 100KHz
+    TWSR = 0;                               // No prescaler
+    TWBR = I2C_DEFAULT_TWBR;                // IC freq = 16Mhz / (16 + 2*TWBR*4^TWPS)
     clear_twint_flag();                     // Init IC controller
 }
\ No newline at end of file
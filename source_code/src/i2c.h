@@ -28,11 +28,50 @@
 
 #include "defines.h"
 
+// Structs
+typedef struct
+{
+    uint8_t addr;
+    uint8_t reg;
+    uint8_t data;
+    uint8_t flags;
+    volatile uint8_t* read_dest;
+    volatile RET_TYPE* status;
+} i2cTransaction_t;
+
+// Typedefs
+typedef void (*i2cCallback_t)(void);
+
 // Prototypes
+void i2cSetCompletionCallback(i2cCallback_t callback);
+void i2cQueueCachedRead(uint8_t addr, uint8_t reg, volatile uint8_t* data, volatile RET_TYPE* status);
+void i2cQueueRead(uint8_t addr, uint8_t reg, volatile uint8_t* data, volatile RET_TYPE* status);
+void i2cQueueWrite(uint8_t addr, uint8_t reg, uint8_t data, volatile RET_TYPE* status);
+RET_TYPE readCachedDataFromI2C(uint8_t addr, uint8_t reg, uint8_t* data);
 RET_TYPE readDataFromI2C(uint8_t addr, uint8_t reg, uint8_t* data);
 RET_TYPE writeDataToI2C(uint8_t addr, uint8_t reg, uint8_t data);
+RET_TYPE i2cSelectDeviceSpeed(uint8_t addr, uint8_t reg);
+uint16_t getI2cNbTimeouts(void);
+uint8_t isI2cIdle(void);
+void i2cTick(void);
 void initI2cPort(void);
 
+/** I2C bus speed defines: freq = 16Mhz / (16 + 2*TWBR) **/
+#define I2C_TWBR_400KHZ     12
+#define I2C_TWBR_200KHZ     32
+#define I2C_TWBR_100KHZ     72
+#define I2C_DEFAULT_TWBR    I2C_TWBR_400KHZ     // Fastest speed tried for each device
+#define I2C_TRANSACTION_TIMEOUT 5               // Max ms without progress before a transaction is aborted
+
+/** I2C transaction queue defines **/
+#define I2C_QUEUE_SIZE      16                  // Must be a power of 2
+#define I2C_QUEUE_MASK      (I2C_QUEUE_SIZE-1)
+#define I2C_FLAG_CACHED_POINTER 0x01            // Skip the command byte write if the device already points to the register
+
+/** Device command byte cache defines **/
+#define I2C_DEVICE_TABLE_SIZE  16              // Must be a power of 2, 0x20-0x27 & 0x38-0x3F get distinct entries
+#define I2C_DEVICE_INDEX(addr)   (((addr) >> 1) & (I2C_DEVICE_TABLE_SIZE-1))
+
 /** I2C controller defines **/
 #define I2C_START		    0x08
 #define	I2C_RSTART		    0x10
@@ -52,6 +91,8 @@ void initI2cPort(void);
 #define	I2C_DATA_ERROR	    RETURN_OK - 3
 #define	I2C_RSTART_ERR	    RETURN_OK - 4
 #define	I2C_SLAR_ERROR      RETURN_OK - 5
+#define I2C_TIMEOUT_ERROR   RETURN_OK - 6
+#define I2C_PENDING         RETURN_OK + 1
 
 // Macros
 /*! \fn     start_condition()
@@ -74,4 +115,19 @@ void initI2cPort(void);
 */
 #define acknowledge_data()      (TWCR = (1<<TWINT) | (1<<TWEN) | (1 << TWEA))
 
+/*! \fn     start_condition_isr()
+*   \brief  Generate start condition, interrupt on completion
+*/
+#define start_condition_isr()   (TWCR = (1<<TWINT)|(1<<TWSTA)|(1<<TWEN)|(1<<TWIE))
+
+/*! \fn     stop_start_condition_isr()
+*   \brief  Generate stop condition followed by a start condition, interrupt on completion
+*/
+#define stop_start_condition_isr()  (TWCR = (1<<TWINT)|(1<<TWSTA)|(1<<TWSTO)|(1<<TWEN)|(1<<TWIE))
+
+/*! \fn     clear_twint_flag_isr()
+*   \brief  Clear TWINT flag, interrupt on completion
+*/
+#define clear_twint_flag_isr()  (TWCR = (1<<TWINT) | (1<<TWEN) | (1<<TWIE))
+
 #endif /* TOUCH_H_ */
\ No newline at end of file
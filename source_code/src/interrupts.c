@@ -23,8 +23,10 @@
 #include <avr/interrupt.h>
 #include <util/atomic.h>
 #include "timer_manager.h"
+#include "socket_events.h"
 #include "mini_inputs.h"
 #include "interrupts.h"
+#include "i2c.h"
 #include "smartcard.h"
 #include "mini_leds.h"
 
@@ -40,6 +42,8 @@
 ISR(TIMER1_COMPA_vect)                                              // Match on TCNT1 & OCR1 Interrupt Handler, 1 ms interrupt
 {
     timerManagerTick();                                             // Our timer manager
+    socketEventsTick();                                             // Sample socket interrupt lines
+    i2cTick();                                                      // Abort stuck I2C transactions
     #ifdef ENABLE_MILLISECOND_DBG_TIMER
         msecTicks++;                                                // Increment ms timer
     #endif
@@ -63,6 +67,29 @@ uint32_t millis()
 }
 #endif
 
+/*! \fn     getTimer1Timestamp(void)
+*   \brief  Get a timestamp combining the ms tick and the Timer1 counter
+*   \return Number of 0.5us since power up, wraps every ~35 minutes
+*/
+uint32_t getTimer1Timestamp(void)
+{
+    uint32_t ms;
+    uint16_t counter;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        ms = getTimestampMs();
+        counter = TCNT1;
+        // Counter cleared but the 1ms interrupt not serviced yet
+        if ((TIFR1 & (1 << OCF1A)) && (counter < TIMER1_COUNTS_PER_MS/2))
+        {
+            ms++;
+        }
+    }
+    
+    return ms * TIMER1_COUNTS_PER_MS + counter;
+}
+
 /*! \fn     initIRQ(void)
 *   \brief  Initialize the interrupts
 */
@@ -26,10 +26,13 @@
 #include <stdint.h>
 
 void initIRQ(void);
+uint32_t getTimer1Timestamp(void);
 #ifdef ENABLE_MILLISECOND_DBG_TIMER
     uint32_t millis();
 #else
     #define millis()    0
 #endif
 
+#define TIMER1_COUNTS_PER_MS    2000    // 16M/8, one count every 0.5us
+
 #endif /* INTERRUPTS_H_ */
@@ -0,0 +1,106 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     loop_profiler.c
+*    \brief    Main loop phases profiler
+*    Created:  17/10/2026
+*
+*    Phases are delimited by Timer1 timestamps, see getTimer1Timestamp().
+*    Sums are reset with the statistics, a 32 bits sum of 0.5us units is
+*    good for more than 30 minutes of accumulated phase time.
+*/
+#include "loop_profiler.h"
+#include "interrupts.h"
+#include <string.h>
+#include "defines.h"
+
+/* Statistics for each phase */
+uint32_t loop_phase_min[NB_LOOP_PHASES];
+uint32_t loop_phase_max[NB_LOOP_PHASES];
+uint32_t loop_phase_sum[NB_LOOP_PHASES];
+uint16_t loop_phase_count[NB_LOOP_PHASES];
+
+
+/*! \fn     saturate16(uint32_t val)
+*   \brief  Saturate a value to 16 bits
+*   \param  val     The value
+*   \return The saturated value
+*/
+static inline uint16_t saturate16(uint32_t val)
+{
+    if (val > 0xFFFF)
+    {
+        return 0xFFFF;
+    }
+    return (uint16_t)val;
+}
+
+/*! \fn     loopProfilerRecord(uint8_t phase, uint32_t* start)
+*   \brief  Record the end of a phase
+*   \param  phase   The phase
+*   \param  start   Timestamp of the phase start, updated to the current one so phases can be chained
+*/
+void loopProfilerRecord(uint8_t phase, uint32_t* start)
+{
+    uint32_t now = getTimer1Timestamp();
+    uint32_t duration = now - *start;
+
+    *start = now;
+    if ((loop_phase_count[phase] == 0) || (duration < loop_phase_min[phase]))
+    {
+        loop_phase_min[phase] = duration;
+    }
+    if (duration > loop_phase_max[phase])
+    {
+        loop_phase_max[phase] = duration;
+    }
+    if (loop_phase_count[phase] != 0xFFFF)
+    {
+        loop_phase_sum[phase] += duration;
+        loop_phase_count[phase]++;
+    }
+}
+
+/*! \fn     getAndResetLoopProfile(loopPhaseReport_t* reports, uint8_t reset)
+*   \brief  Get the statistics of all phases
+*   \param  reports Where to store the NB_LOOP_PHASES reports
+*   \param  reset   TRUE to clear the statistics
+*/
+void getAndResetLoopProfile(loopPhaseReport_t* reports, uint8_t reset)
+{
+    for (uint8_t i = 0; i < NB_LOOP_PHASES; i++)
+    {
+        reports[i].min = saturate16(loop_phase_min[i]);
+        reports[i].max = saturate16(loop_phase_max[i]);
+        reports[i].count = loop_phase_count[i];
+        reports[i].mean = 0;
+        if (loop_phase_count[i] != 0)
+        {
+            reports[i].mean = saturate16(loop_phase_sum[i] / loop_phase_count[i]);
+        }
+    }
+
+    if (reset != FALSE)
+    {
+        memset(loop_phase_min, 0x00, sizeof(loop_phase_min));
+        memset(loop_phase_max, 0x00, sizeof(loop_phase_max));
+        memset(loop_phase_sum, 0x00, sizeof(loop_phase_sum));
+        memset(loop_phase_count, 0x00, sizeof(loop_phase_count));
+    }
+}
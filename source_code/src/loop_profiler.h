@@ -0,0 +1,61 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     loop_profiler.h
+*    \brief    Main loop phases profiler
+*    Created:  17/10/2026
+*/
+
+
+#ifndef LOOP_PROFILER_H_
+#define LOOP_PROFILER_H_
+
+#include "interrupts.h"
+#include "scheduler.h"
+#include "defines.h"
+#include <stdint.h>
+
+// Structs
+typedef struct
+{
+    uint16_t min;               // All durations in 0.5us units, saturated at 0xFFFF
+    uint16_t max;
+    uint16_t mean;
+    uint16_t count;             // Saturated at 0xFFFF
+} loopPhaseReport_t;
+
+// Prototypes
+void getAndResetLoopProfile(loopPhaseReport_t* reports, uint8_t reset);
+void loopProfilerRecord(uint8_t phase, uint32_t* start);
+
+// Defines
+// Phases 0 to NB_SCHEDULER_TASKS-1: scheduler tasks, see scheduler.h
+#define PHASE_LOOP                  NB_SCHEDULER_TASKS      // Complete main loop iteration
+#define NB_LOOP_PHASES              (NB_SCHEDULER_TASKS+1)
+
+// Macros
+#ifdef ENABLE_LOOP_PROFILER
+    #define LOOP_PROFILER_START(ts)             uint32_t ts = getTimer1Timestamp()
+    #define LOOP_PROFILER_RECORD(phase, ts)     loopProfilerRecord(phase, &ts)
+#else
+    #define LOOP_PROFILER_START(ts)
+    #define LOOP_PROFILER_RECORD(phase, ts)
+#endif
+
+#endif /* LOOP_PROFILER_H_ */
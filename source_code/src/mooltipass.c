@@ -44,9 +44,17 @@
 #include "oled_wrapper.h"
 #include "logic_eeprom.h"
 #include "hid_defines.h"
+#include "loop_profiler.h"
+#include "soft_i2c.h"
 #include "mini_inputs.h"
 #include "mooltipass.h"
 #include "interrupts.h"
+#include "prog_rig_sockets.h"
+#include "socket_events.h"
+#include "socket_reports.h"
+#include "socket_stats.h"
+#include "socket_latency.h"
+#include "scheduler.h"
 #include "smartcard.h"
 #include "mini_leds.h"
 #include "flash_mem.h"
@@ -70,25 +78,48 @@ uint8_t act_detected_flag = FALSE;
 /* Defines for IOs connected on the PCA9554 */
 #define PCA_PSU_EN_MASK         0x40
 #define PCA_COLOR_MASK          0x07
-/* Arrays for interrupt signals */
-volatile uint8_t* int_ddr_array[] = {&DDRF, &DDRC, &DDRC, &DDRB, &DDRB, &DDRB, &DDRB, &DDRB};
-volatile uint8_t* int_port_array[] = {&PORTF, &PORTC, &PORTC, &PORTB, &PORTB, &PORTB, &PORTB, &PORTB};
-volatile uint8_t* int_pin_array[] = {&PINF, &PINC, &PINC, &PINB, &PINB, &PINB, &PINB, &PINB};
-uint8_t int_pin_id_array[] = {1 << 7, 1 << 7, 1 << 6, 1 << 2, 1 << 3, 1 << 7, 1 << 6, 1 << 5};
+#define PCA_OUTPUT_UNKNOWN      0xFF    // Shadow value after a failed write, never written
+/* Delays for programming sockets */
+#define PROG_RIG_5V_SETTLING_DEL    200
+#define PROG_RIG_HOST_TIMEOUT_DEL   60000
+/* Failed output writes: retry period, doubled at each consecutive failure, and max consecutive retries */
+#define PROG_RIG_WRITE_RETRY_DEL    50
+#define PROG_RIG_WRITE_MAX_RETRIES  5
 /* Current states on all programming rigs */
-uint8_t programming_states[9];
+uint8_t programming_states[NB_PROG_RIGS];
 /* RED led state for blinking */
-uint8_t red_led_blinking_state[9];
+uint8_t red_led_blinking_state[NB_PROG_RIGS];
 /* 5v powered states for programming sockets */
-uint8_t prog_socket_powered_state[9];
+uint8_t prog_socket_powered_state[NB_PROG_RIGS];
 /* Colors currently displayed */
-uint8_t prog_socket_displayed_colors[9];
+uint8_t prog_socket_displayed_colors[NB_PROG_RIGS];
+/* Last value written to the PCA9554 output registers, and if it may need an update */
+uint8_t prog_socket_output_shadow[NB_EXPANDER_SOCKETS];
+uint8_t prog_socket_output_dirty[NB_EXPANDER_SOCKETS];
+/* Status of the last output register write, checked by the inputs task */
+volatile RET_TYPE prog_socket_output_write_status[NB_EXPANDER_SOCKETS];
+/* Consecutive output write failures, and retry periods to wait before writing again */
+uint8_t prog_socket_output_write_failures[NB_EXPANDER_SOCKETS];
+uint8_t prog_socket_output_retry_countdown[NB_EXPANDER_SOCKETS];
+/* Number of output register writes issued, suppressed & failed */
+uint32_t prog_socket_output_writes_issued;
+uint32_t prog_socket_output_writes_suppressed;
+uint32_t prog_socket_output_writes_failed;
 /* Button pressed buffer to return to the computer */
-uint8_t button_pressed_states_return[9];
+uint8_t button_pressed_states_return[NB_PROG_RIGS];
+/* Input port values read in the background, their transaction status and if a read is in flight */
+volatile uint8_t prog_rig_inputs[NB_EXPANDER_SOCKETS];
+volatile RET_TYPE prog_rig_inputs_status[NB_EXPANDER_SOCKETS];
+uint8_t prog_rig_inputs_read_in_flight[NB_EXPANDER_SOCKETS];
+/* Timestamp of the interrupt that triggered the background read */
+uint16_t prog_rig_event_timestamps[NB_EXPANDER_SOCKETS];
+/* Direct socket event waiting for its task, and its timestamp */
+uint8_t direct_prog_rig_event_pending;
+uint16_t direct_prog_rig_event_timestamp;
 /* enum for colors */
 enum color_t    {RED = 0x01, ORANGE = 0x02, GREEN = 0x04, BLACK = 0x00};
 /* enum for programming states */
-enum prog_state {PROG_IDLE = 0, PROG_ERROR_SHORTED, PROG_PROGRAMMING, PROG_ERROR};
+enum prog_state {PROG_IDLE = 0, PROG_ERROR_SHORTED, PROG_PROGRAMMING, PROG_ERROR, PROG_HOST_PROGRAMMING};
 
 void get_and_clear_button_pressed_return(uint8_t* buffer)
 {
@@ -96,31 +127,155 @@ void get_and_clear_button_pressed_return(uint8_t* buffer)
     memset(button_pressed_states_return, 0x00, sizeof(button_pressed_states_return));
 }
 
+void get_prog_rig_output_write_counters(uint32_t* issued, uint32_t* suppressed, uint32_t* failed)
+{
+    *issued = prog_socket_output_writes_issued;
+    *suppressed = prog_socket_output_writes_suppressed;
+    *failed = prog_socket_output_writes_failed;
+}
+
+uint8_t are_all_prog_rigs_idle(void)
+{
+    for (uint8_t i = 0; i < NB_PROG_RIGS; i++)
+    {
+        if (programming_states[i] != PROG_IDLE)
+        {
+            return FALSE;
+        }
+    }
+    return TRUE;
+}
+
+void mark_prog_rig_output_dirty(uint8_t id)
+{
+    /* Already pending: both changes will go out in the same write */
+    if (prog_socket_output_dirty[id] != FALSE)
+    {
+        prog_socket_output_writes_suppressed++;
+    }
+    prog_socket_output_dirty[id] = TRUE;
+    schedulerWakeTask(TASK_OUTPUTS);
+}
+
+void flush_prog_rig_outputs(void)
+{
+    for (uint8_t id = 0; id < NB_EXPANDER_SOCKETS; id++)
+    {
+        if (prog_socket_output_dirty[id] != FALSE)
+        {
+            uint8_t output_val = prog_socket_displayed_colors[id] | prog_socket_powered_state[id];
+            prog_socket_output_dirty[id] = FALSE;
+            
+            /* Only write the output register if its contents change */
+            if (output_val != prog_socket_output_shadow[id])
+            {
+                if ((prog_socket_output_shadow[id] != PCA_OUTPUT_UNKNOWN) && ((prog_socket_output_shadow[id] & PCA_PSU_EN_MASK) != 0) && ((output_val & PCA_PSU_EN_MASK) == 0))
+                {
+                    socketLatency5vEnabled(id);
+                }
+                prog_socket_output_shadow[id] = output_val;
+                progRigQueueWrite(id, 1, output_val, &prog_socket_output_write_status[id]);
+                prog_socket_output_writes_issued++;
+            }
+            else
+            {
+                prog_socket_output_writes_suppressed++;
+            }
+        }
+    }
+}
+
+void check_prog_rig_output_write(uint8_t id)
+{
+    RET_TYPE write_status = prog_socket_output_write_status[id];
+    
+    if (write_status == I2C_PENDING)
+    {
+        return;
+    }
+    
+    if (write_status != RETURN_OK)
+    {
+        /* The extender kept its previous outputs: forget what we think it has and write it again later, a missing extender mustn't hog the bus */
+        prog_socket_output_write_status[id] = RETURN_OK;
+        prog_socket_output_shadow[id] = PCA_OUTPUT_UNKNOWN;
+        prog_socket_output_writes_failed++;
+        if (prog_socket_output_write_failures[id] < PROG_RIG_WRITE_MAX_RETRIES)
+        {
+            prog_socket_output_retry_countdown[id] = 1 << prog_socket_output_write_failures[id];
+            prog_socket_output_write_failures[id]++;
+            if (getTimerVal(TIMER_PROG_RIG_RETRY) == 0)
+            {
+                activateTimer(TIMER_PROG_RIG_RETRY, PROG_RIG_WRITE_RETRY_DEL);
+            }
+        }
+    }
+    else if (prog_socket_output_shadow[id] != PCA_OUTPUT_UNKNOWN)
+    {
+        /* The last write went through */
+        prog_socket_output_write_failures[id] = 0;
+    }
+}
+
+void retry_prog_rig_outputs(void)
+{
+    uint8_t retry_pending = FALSE;
+    
+    for (uint8_t id = 0; id < NB_EXPANDER_SOCKETS; id++)
+    {
+        if (prog_socket_output_retry_countdown[id] != 0)
+        {
+            if (--prog_socket_output_retry_countdown[id] == 0)
+            {
+                mark_prog_rig_output_dirty(id);
+            }
+            else
+            {
+                retry_pending = TRUE;
+            }
+        }
+    }
+    if (retry_pending != FALSE)
+    {
+        activateTimer(TIMER_PROG_RIG_RETRY, PROG_RIG_WRITE_RETRY_DEL);
+    }
+}
+
 void set_prog_rig_led_color(uint8_t id, uint8_t color)
 {
     prog_socket_displayed_colors[id] = (~color) & PCA_COLOR_MASK;
-    writeDataToI2C(0x70 | (id << 1), 1, prog_socket_displayed_colors[id] | prog_socket_powered_state[id]);  
+    mark_prog_rig_output_dirty(id);
 }
 
 void disable_prog_rig_5v(uint8_t id)
 {
     prog_socket_powered_state[id] = PCA_PSU_EN_MASK;
-    writeDataToI2C(0x70 | (id << 1), 1, prog_socket_displayed_colors[id] | prog_socket_powered_state[id]);    
+    mark_prog_rig_output_dirty(id);
 }
 
 void enable_prog_rig_5v(uint8_t id)
 {
     prog_socket_powered_state[id] = 0;
-    writeDataToI2C(0x70 | (id << 1), 1, prog_socket_displayed_colors[id] | prog_socket_powered_state[id]); 
+    mark_prog_rig_output_dirty(id);
 }
 
 uint8_t read_prog_rig_inputs(uint8_t id)
 {
     uint8_t current_inputs;
-    readDataFromI2C(0x70 | (id << 1), 0, &current_inputs);
+    progRigCachedRead(id, 0, &current_inputs);
     return current_inputs;    
 }
 
+void request_prog_rig_inputs(uint8_t id)
+{
+    /* The interrupt line stays asserted until the read is done, no need to queue it twice */
+    if (prog_rig_inputs_read_in_flight[id] == FALSE)
+    {
+        prog_rig_inputs_read_in_flight[id] = TRUE;
+        progRigQueueCachedRead(id, 0, &prog_rig_inputs[id], &prog_rig_inputs_status[id]);
+    }
+}
+
 void platform_io_init(void)
 {
     memset(button_pressed_states_return, 0x00, sizeof(button_pressed_states_return));
@@ -135,20 +290,16 @@ void platform_io_init(void)
     DDRF |= 0x33;
     PORTF |= 0x33;
     
-    /* int signals: input with pull ups */
-    for (uint8_t i = 0; i < 8; i++)
-    {
-        *int_ddr_array[i] &= ~(int_pin_id_array[i]);
-        *int_port_array[i] |= (int_pin_id_array[i]);
-    }
-    
     /* init gpio extenders */
-    for (uint8_t id = 0; id < 8; id++)
+    for (uint8_t id = 0; id < NB_EXPANDER_SOCKETS; id++)
     {
+        /* fastest bus speed this extender answers to */
+        progRigSelectSpeed(id);
         /* pin mapping: 0 LED1, 1 LED2, 2 LED3, 3 switch, 6 psu_en, 7 psu_fault */
-        writeDataToI2C(0x70 | (id << 1), 3, 0x88);
+        progRigWrite(id, 3, 0x88);
         /* reset outputs in case it is a quick reboot */
-        writeDataToI2C(0x70 | (id << 1), 1, 0x07);
+        progRigWrite(id, 1, 0x07);
+        prog_socket_output_shadow[id] = 0x07;
         /* read to clear interrupts */
         read_prog_rig_inputs(id);
         /* disable 5v supplied to this prog rig */
@@ -156,12 +307,16 @@ void platform_io_init(void)
         /* set led to green to signal ready */        
         set_prog_rig_led_color(id, GREEN);    
     }   
+    flush_prog_rig_outputs();
     PORTF &= ~0x01; 
+    
+    /* int signals & their interrupts, only armed once the extenders are setup */
+    initSocketEvents();
 }
 
 void programming_success(uint8_t socket_id)
 {
-    if (socket_id != 8)
+    if (socket_id != DIRECT_SOCKET_ID)
     {
         disable_prog_rig_5v(socket_id);
         set_prog_rig_led_color(socket_id, GREEN);
@@ -171,12 +326,18 @@ void programming_success(uint8_t socket_id)
         PORTF |= 0x13;
         PORTF &= ~0x01;
     }
-    programming_states[socket_id] = PROG_IDLE;    
+    programming_states[socket_id] = PROG_IDLE;
+    socketStatsCycleEnded(socket_id, SOCKET_STATS_PASSED);
+    socketLatencyDone(socket_id);
+    
+    /* stop the host timeout */
+    activateTimer(TIMER_PROG_RIG_0+socket_id, 0);
+    hasTimerExpired(TIMER_PROG_RIG_0+socket_id, TRUE);
 }
 
 void programming_failure(uint8_t socket_id)
 {
-    if (socket_id != 8)
+    if (socket_id != DIRECT_SOCKET_ID)
     {
         disable_prog_rig_5v(socket_id);
         set_prog_rig_led_color(socket_id, RED);
@@ -187,7 +348,293 @@ void programming_failure(uint8_t socket_id)
         PORTF &= ~0x10;
     }
     red_led_blinking_state[socket_id] = 0xFF;
-    programming_states[socket_id] = PROG_ERROR;    
+    programming_states[socket_id] = PROG_ERROR;
+    socketStatsCycleEnded(socket_id, SOCKET_STATS_FAILED);
+    
+    /* stop the host timeout */
+    activateTimer(TIMER_PROG_RIG_0+socket_id, 0);
+    hasTimerExpired(TIMER_PROG_RIG_0+socket_id, TRUE);
+}
+
+/*! \fn     process_prog_rig_inputs(uint8_t i, uint8_t io_val)
+*   \brief  Handle the input port value read from a PCA9554 prog rig
+*   \param  i       The socket ID
+*   \param  io_val  The input port value
+*/
+static void process_prog_rig_inputs(uint8_t i, uint8_t io_val)
+{
+    if ((programming_states[i] == PROG_IDLE) || (programming_states[i] == PROG_ERROR) || (programming_states[i] == PROG_ERROR_SHORTED))
+    {
+        /* button pressed? */
+        if ((io_val & 0x08) == 0)
+        {
+            /* enter programming mode */
+            enable_prog_rig_5v(i);
+            set_prog_rig_led_color(i, ORANGE);
+            programming_states[i] = PROG_PROGRAMMING;
+            socketStatsCycleStarted(i);
+            socketLatencyButtonPressed(i, prog_rig_event_timestamps[i]);
+            
+            /* arm timer to signal success */
+            activateTimer(TIMER_PROG_RIG_0+i, PROG_RIG_5V_SETTLING_DEL);
+        }
+    } 
+    else if ((programming_states[i] == PROG_PROGRAMMING) || (programming_states[i] == PROG_HOST_PROGRAMMING))
+    {
+        /* 5v shorted? */
+        if ((io_val & 0x80) == 0)
+        {
+            /* disable 5v, signal error */
+            disable_prog_rig_5v(i);
+            set_prog_rig_led_color(i, RED);
+            red_led_blinking_state[i] = 0xFF;
+            programming_states[i] = PROG_ERROR_SHORTED;
+            socketStatsCycleEnded(i, SOCKET_STATS_SHORTED);
+            queueSocketReport(i, SOCKET_REPORT_SHORTED);
+            
+            /* clear timer */
+            activateTimer(TIMER_PROG_RIG_0+i, 0);
+            hasTimerExpired(TIMER_PROG_RIG_0+i, TRUE);
+        }
+    }
+}
+
+/*! \fn     process_direct_prog_rig_event(uint16_t timestamp)
+*   \brief  Handle an event on the prog rig directly wired to the MCU
+*   \param  timestamp   16 LSBs of the ms timestamp at which the event was detected
+*/
+static void process_direct_prog_rig_event(uint16_t timestamp)
+{
+    if ((programming_states[DIRECT_SOCKET_ID] == PROG_IDLE) || (programming_states[DIRECT_SOCKET_ID] == PROG_ERROR) || (programming_states[DIRECT_SOCKET_ID] == PROG_ERROR_SHORTED))
+    {
+        if ((PINE & 0x40) == 0)
+        {
+            /* enter programming mode */
+            PORTF &= ~0x20;
+            PORTF |= 0x13;
+            PORTF &= ~0x02;
+            programming_states[DIRECT_SOCKET_ID] = PROG_PROGRAMMING;
+            socketStatsCycleStarted(DIRECT_SOCKET_ID);
+            socketLatencyButtonPressed(DIRECT_SOCKET_ID, timestamp);
+            socketLatency5vEnabled(DIRECT_SOCKET_ID);
+            
+            /* arm timer to signal success */
+            activateTimer(TIMER_PROG_RIG_0+DIRECT_SOCKET_ID, PROG_RIG_5V_SETTLING_DEL);
+        }
+    }
+    else if ((programming_states[DIRECT_SOCKET_ID] == PROG_PROGRAMMING) || (programming_states[DIRECT_SOCKET_ID] == PROG_HOST_PROGRAMMING))
+    {
+        if ((PINF & 0x40) == 0)
+        {
+            /* disable 5v, signal error */
+            PORTF |= 0x20;
+            PORTF |= 0x13;
+            PORTF &= ~0x10;
+            red_led_blinking_state[DIRECT_SOCKET_ID] = 0xFF;
+            programming_states[DIRECT_SOCKET_ID] = PROG_ERROR_SHORTED;
+            socketStatsCycleEnded(DIRECT_SOCKET_ID, SOCKET_STATS_SHORTED);
+            queueSocketReport(DIRECT_SOCKET_ID, SOCKET_REPORT_SHORTED);
+            
+            /* clear timer */
+            activateTimer(TIMER_PROG_RIG_0+DIRECT_SOCKET_ID, 0);
+            hasTimerExpired(TIMER_PROG_RIG_0+DIRECT_SOCKET_ID, TRUE);
+        }
+    }
+}
+
+/*! \fn     wake_socket_inputs_task(void)
+*   \brief  I2C completion callback, called from interrupt context
+*/
+static void wake_socket_inputs_task(void)
+{
+    schedulerWakeTask(TASK_SOCKET_INPUTS);
+}
+
+/*! \fn     wake_timers_task(void)
+*   \brief  Prog rig timers callback
+*/
+static void wake_timers_task(void)
+{
+    schedulerWakeTask(TASK_TIMERS);
+}
+
+/*! \fn     wake_outputs_task(void)
+*   \brief  Output writes retry timer callback
+*/
+static void wake_outputs_task(void)
+{
+    schedulerWakeTask(TASK_OUTPUTS);
+}
+
+/*! \fn     wake_blink_task(void)
+*   \brief  Blinking timer callback
+*/
+static void wake_blink_task(void)
+{
+    schedulerWakeTask(TASK_BLINK);
+}
+
+/*! \fn     task_socket_events(void)
+*   \brief  Process socket events queued by the interrupts
+*/
+static void task_socket_events(void)
+{
+    uint16_t event_timestamp;
+    uint8_t socket_id;
+    
+    while (getNextSocketEvent(&socket_id, &event_timestamp) == RETURN_OK)
+    {
+        if (socket_id == DIRECT_SOCKET_ID)
+        {
+            /* Keep the timestamp of the first event */
+            if (direct_prog_rig_event_pending == FALSE)
+            {
+                direct_prog_rig_event_pending = TRUE;
+                direct_prog_rig_event_timestamp = event_timestamp;
+            }
+            schedulerWakeTask(TASK_DIRECT_SOCKET);
+        }
+        else
+        {
+            if (prog_rig_inputs_read_in_flight[socket_id] == FALSE)
+            {
+                prog_rig_event_timestamps[socket_id] = event_timestamp;
+            }
+            /* Read the GPIO extender value in the background, clears the interrupt */
+            request_prog_rig_inputs(socket_id);
+        }
+    }
+}
+
+/*! \fn     task_direct_socket(void)
+*   \brief  Process an event on the prog rig directly wired to the MCU
+*/
+static void task_direct_socket(void)
+{
+    direct_prog_rig_event_pending = FALSE;
+    process_direct_prog_rig_event(direct_prog_rig_event_timestamp);
+}
+
+/*! \fn     task_socket_inputs(void)
+*   \brief  Process the GPIO extender values we received, retry the output writes that failed
+*/
+static void task_socket_inputs(void)
+{
+    for (uint8_t i = 0; i < NB_EXPANDER_SOCKETS; i++)
+    {
+        check_prog_rig_output_write(i);
+        if ((prog_rig_inputs_read_in_flight[i] != FALSE) && (prog_rig_inputs_status[i] != I2C_PENDING))
+        {
+            prog_rig_inputs_read_in_flight[i] = FALSE;
+            if (prog_rig_inputs_status[i] == RETURN_OK)
+            {
+                process_prog_rig_inputs(i, prog_rig_inputs[i]);
+            }
+        }
+    }
+}
+
+/*! \fn     task_outputs(void)
+*   \brief  One output register write per changed extender, or whose failed write is due for a retry
+*/
+static void task_outputs(void)
+{
+    if (hasTimerExpired(TIMER_PROG_RIG_RETRY, TRUE) == TIMER_EXPIRED)
+    {
+        retry_prog_rig_outputs();
+    }
+    flush_prog_rig_outputs();
+}
+
+/*! \fn     task_usb(void)
+*   \brief  Process one incoming USB packet
+*   \note   A host streaming packets keeps the ring filled, the more urgent tasks run between two packets
+*/
+static void task_usb(void)
+{
+    if (isUsbRawHidRxPending() == TRUE)
+    {
+        usbProcessIncoming(USB_CALLER_MAIN);
+    }
+    if (isUsbRawHidRxPending() == TRUE)
+    {
+        schedulerWakeTask(TASK_USB);
+    }
+}
+
+/*! \fn     task_timers(void)
+*   \brief  Handle the prog rig timers that expired
+*/
+static void task_timers(void)
+{
+    for (uint8_t i = 0; i < NB_PROG_RIGS; i++)
+    {            
+        if (hasTimerExpired(TIMER_PROG_RIG_0+i, TRUE) == TIMER_EXPIRED)
+        {
+            if (programming_states[i] == PROG_PROGRAMMING)
+            {
+                /* If we've started to enter programming mode, inform the computer that he can program the MCU */
+                button_pressed_states_return[i] = TRUE;
+                queueSocketReport(i, SOCKET_REPORT_READY);
+                socketLatencyReady(i);
+                programming_states[i] = PROG_HOST_PROGRAMMING;
+                
+                /* Polling hosts may take their time to get to this socket, only a reports host gets a deadline */
+                if (areSocketReportsEnabled() == TRUE)
+                {
+                    activateTimer(TIMER_PROG_RIG_0+i, PROG_RIG_HOST_TIMEOUT_DEL);
+                }
+            }
+            else if ((programming_states[i] == PROG_HOST_PROGRAMMING) && (areSocketReportsEnabled() == TRUE))
+            {
+                /* The computer never told us how it went */
+                programming_failure(i);
+                queueSocketReport(i, SOCKET_REPORT_TIMEOUT);
+            }
+        }
+    }
+}
+
+/*! \fn     task_blink(void)
+*   \brief  Error blinking
+*/
+static void task_blink(void)
+{
+    hasTimerExpired(TIMER_CAPS, TRUE);
+    activateTimer(TIMER_CAPS, 500);
+    for (uint8_t i = 0; i < NB_PROG_RIGS; i++)
+    {
+        if ((programming_states[i] == PROG_ERROR_SHORTED) || (programming_states[i] == PROG_ERROR))
+        {
+            if (i == DIRECT_SOCKET_ID)
+            {
+                if (red_led_blinking_state[i])
+                {
+                    PORTF |= 0x13;
+                    red_led_blinking_state[i] = 0;
+                }
+                else
+                {
+                    PORTF |= 0x13;
+                    PORTF &= ~0x10;
+                    red_led_blinking_state[i] = 0xFF;
+                }
+            } 
+            else
+            {
+                if (red_led_blinking_state[i])
+                {
+                    red_led_blinking_state[i] = 0;
+                    set_prog_rig_led_color(i, BLACK);
+                } 
+                else
+                {
+                    red_led_blinking_state[i] = 0xFF;
+                    set_prog_rig_led_color(i, RED);
+                }
+            }
+        }
+    }
 }
 
 int main(void)
@@ -200,6 +647,9 @@ int main(void)
     initUsb();                                  // Initialize USB controller
     powerSettlingDelay();                       // Let the USB 3.3V LDO rise
     initI2cPort();                              // Initialize I2C interface
+#ifdef PROG_RIG_SOFT_I2C_BUS
+    initSoftI2cPort();                          // Initialize bit banged I2C interface
+#endif
     rngInit();                                  // Initialize avrentropy library
     oledInitIOs();                              // Initialize OLED inputs/outputs
     initFlashIOs();                             // Initialize Flash inputs/outputs
@@ -218,138 +668,44 @@ int main(void)
     miniOledBitmapDrawFlash(0, 0, BITMAP_MOOLTIPASS, OLED_SCROLL_UP);
     miniOledFlushWrittenTextToDisplay();
 
+    /* Tasks, woken by the interrupts, the timers or the polls below */
+    schedulerRegisterTask(TASK_SOCKET_EVENTS, task_socket_events);
+    schedulerRegisterTask(TASK_DIRECT_SOCKET, task_direct_socket);
+    schedulerRegisterTask(TASK_SOCKET_INPUTS, task_socket_inputs);
+    schedulerRegisterTask(TASK_OUTPUTS, task_outputs);
+    schedulerRegisterTask(TASK_USB, task_usb);
+    schedulerRegisterTask(TASK_TIMERS, task_timers);
+    schedulerRegisterTask(TASK_REPORTS, sendSocketReports);
+    schedulerRegisterTask(TASK_BLINK, task_blink);
+    i2cSetCompletionCallback(wake_socket_inputs_task);
+    for (uint8_t i = 0; i < NB_PROG_RIGS; i++)
+    {
+        setTimerCallback(TIMER_PROG_RIG_0+i, wake_timers_task);
+    }
+    setTimerCallback(TIMER_CAPS, wake_blink_task);
+    setTimerCallback(TIMER_PROG_RIG_RETRY, wake_outputs_task);
+    
+    /* Socket events that occurred during the init, outputs set by platform_io_init */
+    schedulerWakeTask(TASK_SOCKET_EVENTS);
+    schedulerWakeTask(TASK_OUTPUTS);
+
     /* Error timer */
     activateTimer(TIMER_CAPS, 500);
     while (1)
     {
-        /* Process possible incoming USB packets */
-        usbProcessIncoming(USB_CALLER_MAIN);
+        LOOP_PROFILER_START(loop_start);
         
-        /* Error blinking */
-        if (hasTimerExpired(TIMER_CAPS, TRUE) == TIMER_EXPIRED)
+        /* Wake conditions that can only be polled */
+        timerManagerRunCallbacks();
+        if ((areSocketReportsPending() == TRUE) && (isUsbHidTxReady() == TRUE))
         {
-            activateTimer(TIMER_CAPS, 500);
-            for (uint8_t i = 0; i < 9; i++)
-            {
-                if ((programming_states[i] == PROG_ERROR_SHORTED) || (programming_states[i] == PROG_ERROR))
-                {
-                    if (i == 8)
-                    {
-                        if (red_led_blinking_state[i])
-                        {
-                            PORTF |= 0x13;
-                            red_led_blinking_state[i] = 0;
-                        }
-                        else
-                        {
-                            PORTF |= 0x13;
-                            PORTF &= ~0x10;
-                            red_led_blinking_state[i] = 0xFF;
-                        }
-                    } 
-                    else
-                    {
-                        if (red_led_blinking_state[i])
-                        {
-                            red_led_blinking_state[i] = 0;
-                            set_prog_rig_led_color(i, BLACK);
-                        } 
-                        else
-                        {
-                            red_led_blinking_state[i] = 0xFF;
-                            set_prog_rig_led_color(i, RED);
-                        }
-                    }
-                }
-            }
+            schedulerWakeTask(TASK_REPORTS);
         }
         
-        /* Scan timers */
-        for (uint8_t i = 0; i < 9; i++)
-        {            
-            if (hasTimerExpired(TIMER_PROG_RIG_0+i, TRUE) == TIMER_EXPIRED)
-            {
-                if (programming_states[i] == PROG_PROGRAMMING)
-                {
-                    /* If we've started to enter programming mode, inform the computer that he can program the MCU */
-                    button_pressed_states_return[i] = TRUE;
-                }
-            }
-        }
-        
-        /* Scan interrupts */
-        for (uint8_t i = 0; i < 8; i++)
+        /* Run the most urgent task */
+        if (schedulerRunNextTask() != SCHEDULER_NO_TASK)
         {
-            /* Do we have an interrupt ? */
-            if ((*int_pin_array[i] & int_pin_id_array[i]) == 0)
-            {
-                //PORTB = (PORTB & 0xFE) | (~PORTB & 0x01);                
-                /* Read the GPIO extender value */
-                uint8_t io_val = read_prog_rig_inputs(i);
-                
-                if ((programming_states[i] == PROG_IDLE) || (programming_states[i] == PROG_ERROR) || (programming_states[i] == PROG_ERROR_SHORTED))
-                {
-                    /* button pressed? */
-                    if ((io_val & 0x08) == 0)
-                    {
-                        /* enter programming mode */
-                        enable_prog_rig_5v(i);
-                        set_prog_rig_led_color(i, ORANGE);
-                        programming_states[i] = PROG_PROGRAMMING;
-                        
-                        /* arm timer to signal success */
-                        activateTimer(TIMER_PROG_RIG_0+i, 200);
-                    }
-                } 
-                else if (programming_states[i] == PROG_PROGRAMMING)
-                {
-                    /* 5v shorted? */
-                    if ((io_val & 0x80) == 0)
-                    {
-                        /* disable 5v, signal error */
-                        disable_prog_rig_5v(i);
-                        set_prog_rig_led_color(i, RED);
-                        red_led_blinking_state[i] = 0xFF;
-                        programming_states[i] = PROG_ERROR_SHORTED;
-                        
-                        /* clear timer */
-                        activateTimer(TIMER_PROG_RIG_0+i, 0);
-                        hasTimerExpired(TIMER_PROG_RIG_0+i, TRUE);
-                    }
-                }                               
-            }
-        }
-        
-        /* prog rig #9 is directly wired to MCU */        
-        if ((programming_states[8] == PROG_IDLE) || (programming_states[8] == PROG_ERROR) || (programming_states[8] == PROG_ERROR_SHORTED))
-        {
-            if ((PINE & 0x40) == 0)
-            {
-                /* enter programming mode */
-                PORTF &= ~0x20;
-                PORTF |= 0x13;
-                PORTF &= ~0x02;
-                programming_states[8] = PROG_PROGRAMMING;
-                
-                /* arm timer to signal success */
-                activateTimer(TIMER_PROG_RIG_0+8, 200);
-            }
+            LOOP_PROFILER_RECORD(PHASE_LOOP, loop_start);
         }
-        else if (programming_states[8] == PROG_PROGRAMMING)
-        {
-            if ((PINF & 0x40) == 0)
-            {
-                /* disable 5v, signal error */
-                PORTF |= 0x20;
-                PORTF |= 0x13;
-                PORTF &= ~0x10;
-                red_led_blinking_state[8] = 0xFF;
-                programming_states[8] = PROG_ERROR_SHORTED;
-                
-                /* clear timer */
-                activateTimer(TIMER_PROG_RIG_0+8, 0);
-                hasTimerExpired(TIMER_PROG_RIG_0+8, TRUE);
-            }
-        }        
     }
 }
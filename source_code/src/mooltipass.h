@@ -41,6 +41,8 @@ extern uint8_t act_detected_flag;
 
 /* Function prototypes */
 void get_and_clear_button_pressed_return(uint8_t* buffer);
+void get_prog_rig_output_write_counters(uint32_t* issued, uint32_t* suppressed, uint32_t* failed);
+uint8_t are_all_prog_rigs_idle(void);
 void programming_success(uint8_t socket_id);
 void programming_failure(uint8_t socket_id);
 void reboot_platform(void);
@@ -0,0 +1,165 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     prog_rig_sockets.c
+*    \brief    Programming sockets table
+*    Created:  17/10/2026
+*
+*    The first 8 extenders are PCA9554As on the TWI bus (0x38-0x3F), a 16
+*    sockets bench adds 8 PCA9554s on the same bus (0x20-0x27) and a 24
+*    sockets bench 8 more PCA9554As on the bit banged bus. Extenders N, N+8
+*    and N+16 share interrupt line N.
+*/
+#include "prog_rig_sockets.h"
+#include "scheduler.h"
+#include "soft_i2c.h"
+#include "defines.h"
+#include "i2c.h"
+
+/* Sockets table */
+const progRigSocket_t prog_rig_sockets[NB_EXPANDER_SOCKETS] =
+{
+    {PROG_RIG_BUS_TWI, PCA9554A_ADDR(0), 0},
+    {PROG_RIG_BUS_TWI, PCA9554A_ADDR(1), 1},
+    {PROG_RIG_BUS_TWI, PCA9554A_ADDR(2), 2},
+    {PROG_RIG_BUS_TWI, PCA9554A_ADDR(3), 3},
+    {PROG_RIG_BUS_TWI, PCA9554A_ADDR(4), 4},
+    {PROG_RIG_BUS_TWI, PCA9554A_ADDR(5), 5},
+    {PROG_RIG_BUS_TWI, PCA9554A_ADDR(6), 6},
+    {PROG_RIG_BUS_TWI, PCA9554A_ADDR(7), 7},
+#if NB_EXPANDER_SOCKETS > 8
+    {PROG_RIG_BUS_TWI, PCA9554_ADDR(0), 0},
+    {PROG_RIG_BUS_TWI, PCA9554_ADDR(1), 1},
+    {PROG_RIG_BUS_TWI, PCA9554_ADDR(2), 2},
+    {PROG_RIG_BUS_TWI, PCA9554_ADDR(3), 3},
+    {PROG_RIG_BUS_TWI, PCA9554_ADDR(4), 4},
+    {PROG_RIG_BUS_TWI, PCA9554_ADDR(5), 5},
+    {PROG_RIG_BUS_TWI, PCA9554_ADDR(6), 6},
+    {PROG_RIG_BUS_TWI, PCA9554_ADDR(7), 7},
+#endif
+#if NB_EXPANDER_SOCKETS > 16
+    {PROG_RIG_BUS_SOFT, PCA9554A_ADDR(0), 0},
+    {PROG_RIG_BUS_SOFT, PCA9554A_ADDR(1), 1},
+    {PROG_RIG_BUS_SOFT, PCA9554A_ADDR(2), 2},
+    {PROG_RIG_BUS_SOFT, PCA9554A_ADDR(3), 3},
+    {PROG_RIG_BUS_SOFT, PCA9554A_ADDR(4), 4},
+    {PROG_RIG_BUS_SOFT, PCA9554A_ADDR(5), 5},
+    {PROG_RIG_BUS_SOFT, PCA9554A_ADDR(6), 6},
+    {PROG_RIG_BUS_SOFT, PCA9554A_ADDR(7), 7},
+#endif
+};
+
+
+/*! \fn     progRigQueueWrite(uint8_t id, uint8_t reg, uint8_t data, volatile RET_TYPE* status)
+*   \brief  Write a socket extender register, in the background when possible
+*   \param  id      The socket ID
+*   \param  reg     The register
+*   \param  data    The data to write
+*   \param  status  Set to I2C_PENDING, then to the transaction result. May be 0
+*/
+void progRigQueueWrite(uint8_t id, uint8_t reg, uint8_t data, volatile RET_TYPE* status)
+{
+#ifdef PROG_RIG_SOFT_I2C_BUS
+    if (prog_rig_sockets[id].bus == PROG_RIG_BUS_SOFT)
+    {
+        RET_TYPE write_status = softI2cWrite(prog_rig_sockets[id].addr, reg, data);
+        if (status != 0)
+        {
+            /* Same wake up as a TWI completion */
+            *status = write_status;
+            schedulerWakeTask(TASK_SOCKET_INPUTS);
+        }
+        return;
+    }
+#endif
+    i2cQueueWrite(prog_rig_sockets[id].addr, reg, data, status);
+}
+
+/*! \fn     progRigQueueCachedRead(uint8_t id, uint8_t reg, volatile uint8_t* data, volatile RET_TYPE* status)
+*   \brief  Read a socket extender register, in the background when possible
+*   \param  id      The socket ID
+*   \param  reg     The register
+*   \param  data    Where to store the read data
+*   \param  status  Set to I2C_PENDING, then to the transaction result
+*   \note   Wakes TASK_SOCKET_INPUTS on completion
+*/
+void progRigQueueCachedRead(uint8_t id, uint8_t reg, volatile uint8_t* data, volatile RET_TYPE* status)
+{
+#ifdef PROG_RIG_SOFT_I2C_BUS
+    if (prog_rig_sockets[id].bus == PROG_RIG_BUS_SOFT)
+    {
+        uint8_t read_data = 0;
+        *status = softI2cRead(prog_rig_sockets[id].addr, reg, &read_data);
+        *data = read_data;
+        /* Same wake up as a TWI completion */
+        schedulerWakeTask(TASK_SOCKET_INPUTS);
+        return;
+    }
+#endif
+    i2cQueueCachedRead(prog_rig_sockets[id].addr, reg, data, status);
+}
+
+/*! \fn     progRigWrite(uint8_t id, uint8_t reg, uint8_t data)
+*   \brief  Write a socket extender register
+*   \param  id      The socket ID
+*   \param  reg     The register
+*   \param  data    The data to write
+*   \return Operation success
+*/
+RET_TYPE progRigWrite(uint8_t id, uint8_t reg, uint8_t data)
+{
+#ifdef PROG_RIG_SOFT_I2C_BUS
+    if (prog_rig_sockets[id].bus == PROG_RIG_BUS_SOFT)
+    {
+        return softI2cWrite(prog_rig_sockets[id].addr, reg, data);
+    }
+#endif
+    return writeDataToI2C(prog_rig_sockets[id].addr, reg, data);
+}
+
+/*! \fn     progRigCachedRead(uint8_t id, uint8_t reg, uint8_t* data)
+*   \brief  Read a socket extender register
+*   \param  id      The socket ID
+*   \param  reg     The register
+*   \param  data    Where to store the read data
+*   \return Operation success
+*/
+RET_TYPE progRigCachedRead(uint8_t id, uint8_t reg, uint8_t* data)
+{
+#ifdef PROG_RIG_SOFT_I2C_BUS
+    if (prog_rig_sockets[id].bus == PROG_RIG_BUS_SOFT)
+    {
+        return softI2cRead(prog_rig_sockets[id].addr, reg, data);
+    }
+#endif
+    return readCachedDataFromI2C(prog_rig_sockets[id].addr, reg, data);
+}
+
+/*! \fn     progRigSelectSpeed(uint8_t id)
+*   \brief  Select the fastest bus speed a socket extender answers to
+*   \param  id      The socket ID
+*/
+void progRigSelectSpeed(uint8_t id)
+{
+    /* The bit banged bus has a single speed */
+    if (prog_rig_sockets[id].bus == PROG_RIG_BUS_TWI)
+    {
+        i2cSelectDeviceSpeed(prog_rig_sockets[id].addr, 0);
+    }
+}
@@ -0,0 +1,74 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     prog_rig_sockets.h
+*    \brief    Programming sockets table
+*    Created:  17/10/2026
+*/
+
+
+#ifndef PROG_RIG_SOCKETS_H_
+#define PROG_RIG_SOCKETS_H_
+
+#include "defines.h"
+#include <stdint.h>
+
+// Structs
+typedef struct
+{
+    uint8_t bus;                // PROG_RIG_BUS_TWI or PROG_RIG_BUS_SOFT
+    uint8_t addr;               // Extender address, 8 bits format
+    uint8_t int_line;           // Interrupt line the extender INT output is wired to
+} progRigSocket_t;
+
+// Prototypes
+RET_TYPE progRigCachedRead(uint8_t id, uint8_t reg, uint8_t* data);
+RET_TYPE progRigWrite(uint8_t id, uint8_t reg, uint8_t data);
+void progRigQueueCachedRead(uint8_t id, uint8_t reg, volatile uint8_t* data, volatile RET_TYPE* status);
+void progRigQueueWrite(uint8_t id, uint8_t reg, uint8_t data, volatile RET_TYPE* status);
+void progRigSelectSpeed(uint8_t id);
+
+/** Bench configuration, can be overridden from the makefile **/
+#ifndef NB_EXPANDER_SOCKETS
+    #define NB_EXPANDER_SOCKETS     8       // Sockets driven through a PCA9554(A) extender: 8, 16 or 24
+#endif
+#if (NB_EXPANDER_SOCKETS != 8) && (NB_EXPANDER_SOCKETS != 16) && (NB_EXPANDER_SOCKETS != 24)
+    #error "Unsupported number of extender sockets"
+#endif
+#if NB_EXPANDER_SOCKETS > 16
+    #define PROG_RIG_SOFT_I2C_BUS           // Extenders 16 to 23 are on the bit banged bus
+#endif
+#define DIRECT_SOCKET_ID            NB_EXPANDER_SOCKETS     // Socket directly wired to the MCU
+#define NB_PROG_RIGS                (NB_EXPANDER_SOCKETS+1)
+
+/** Extender addresses, A2..A0 set by the straps **/
+#define PCA9554A_ADDR(straps)       (0x70 | ((straps) << 1))    // 0x38 - 0x3F
+#define PCA9554_ADDR(straps)        (0x40 | ((straps) << 1))    // 0x20 - 0x27
+
+/** Buses **/
+#define PROG_RIG_BUS_TWI            0
+#define PROG_RIG_BUS_SOFT           1
+
+/** Interrupt lines, INT outputs of extenders sharing a line are wired together **/
+#define NB_PROG_RIG_INT_LINES       8
+
+// Shared variables
+extern const progRigSocket_t prog_rig_sockets[NB_EXPANDER_SOCKETS];
+
+#endif /* PROG_RIG_SOCKETS_H_ */
@@ -0,0 +1,97 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     scheduler.c
+*    \brief    Run to completion task scheduler
+*    Created:  17/10/2026
+*
+*    Tasks are woken by interrupts, timer callbacks or the main loop and
+*    always run to completion. After each task the most urgent ready one
+*    is picked again, so the worst case response time of a task is the
+*    longest task duration plus its own duration.
+*/
+#include <util/atomic.h>
+#include "loop_profiler.h"
+#include "scheduler.h"
+#include "defines.h"
+
+/* Tasks functions, index is the priority */
+taskFunction_t scheduler_tasks[NB_SCHEDULER_TASKS];
+/* One bit per task ready to run */
+volatile uint8_t scheduler_ready_tasks;
+
+
+/*! \fn     schedulerRegisterTask(uint8_t task_id, taskFunction_t task)
+*   \brief  Register the function of a task
+*   \param  task_id     The task ID
+*   \param  task        The task function
+*/
+void schedulerRegisterTask(uint8_t task_id, taskFunction_t task)
+{
+    scheduler_tasks[task_id] = task;
+}
+
+/*! \fn     schedulerWakeTask(uint8_t task_id)
+*   \brief  Mark a task as ready to run, can be called from interrupts
+*   \param  task_id     The task ID
+*/
+void schedulerWakeTask(uint8_t task_id)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        scheduler_ready_tasks |= (1 << task_id);
+    }
+}
+
+/*! \fn     schedulerRunNextTask(void)
+*   \brief  Run the most urgent ready task
+*   \return The ID of the task that ran, SCHEDULER_NO_TASK if none was ready
+*/
+uint8_t schedulerRunNextTask(void)
+{
+    uint8_t task_id;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        for (task_id = 0; task_id < NB_SCHEDULER_TASKS; task_id++)
+        {
+            if (scheduler_ready_tasks & (1 << task_id))
+            {
+                break;
+            }
+        }
+        if (task_id == NB_SCHEDULER_TASKS)
+        {
+            task_id = SCHEDULER_NO_TASK;
+        }
+        else
+        {
+            // Cleared before running: a wake up during the task makes it run again
+            scheduler_ready_tasks &= ~(1 << task_id);
+        }
+    }
+
+    if ((task_id != SCHEDULER_NO_TASK) && (scheduler_tasks[task_id] != 0))
+    {
+        LOOP_PROFILER_START(task_start);
+        scheduler_tasks[task_id]();
+        LOOP_PROFILER_RECORD(task_id, task_start);
+    }
+    return task_id;
+}
@@ -0,0 +1,52 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     scheduler.h
+*    \brief    Run to completion task scheduler
+*    Created:  17/10/2026
+*/
+
+
+#ifndef SCHEDULER_H_
+#define SCHEDULER_H_
+
+#include "defines.h"
+#include <stdint.h>
+
+// Typedefs
+typedef void (*taskFunction_t)(void);
+
+// Prototypes
+void schedulerRegisterTask(uint8_t task_id, taskFunction_t task);
+void schedulerWakeTask(uint8_t task_id);
+uint8_t schedulerRunNextTask(void);
+
+// Task IDs, also their priority: lower is more urgent
+#define TASK_SOCKET_EVENTS      0       // Dequeue socket interrupts, start the extender reads
+#define TASK_DIRECT_SOCKET      1       // Direct socket GPIO handling
+#define TASK_SOCKET_INPUTS      2       // Extender inputs: shorted socket shutdown & button presses
+#define TASK_OUTPUTS            3       // Extender output writes
+#define TASK_USB                4       // Incoming USB packets
+#define TASK_TIMERS             5       // Prog rig timers: socket ready & host timeouts
+#define TASK_REPORTS            6       // Socket reports to the host
+#define TASK_BLINK              7       // Error leds blinking
+#define NB_SCHEDULER_TASKS      8       // Max 8, one bit per task
+#define SCHEDULER_NO_TASK       0xFF
+
+#endif /* SCHEDULER_H_ */
@@ -0,0 +1,176 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     socket_events.c
+*    \brief    Interrupt driven programming socket events
+*    Created:  17/10/2026
+*
+*    The PCA9554 INT lines are active low and stay asserted until the input
+*    port is read. Lines wired to PCINT-capable pins (PB2/3/5/6/7) and the
+*    direct socket button (INT6) trigger an immediate scan, the remaining
+*    lines (PF7, PC7, PC6, PF6) are sampled by the 1ms tick. All extenders
+*    sharing an asserted line are queued, as any of them may drive it. A
+*    socket is only queued once until the main loop has dequeued it, so the
+*    ring buffer can never overflow.
+*/
+#include <avr/interrupt.h>
+#include "timer_manager.h"
+#include "socket_events.h"
+#include "scheduler.h"
+#include "defines.h"
+
+/* Arrays for interrupt lines */
+volatile uint8_t* int_ddr_array[] = {&DDRF, &DDRC, &DDRC, &DDRB, &DDRB, &DDRB, &DDRB, &DDRB};
+volatile uint8_t* int_port_array[] = {&PORTF, &PORTC, &PORTC, &PORTB, &PORTB, &PORTB, &PORTB, &PORTB};
+volatile uint8_t* int_pin_array[] = {&PINF, &PINC, &PINC, &PINB, &PINB, &PINB, &PINB, &PINB};
+uint8_t int_pin_id_array[] = {1 << 7, 1 << 7, 1 << 6, 1 << 2, 1 << 3, 1 << 7, 1 << 6, 1 << 5};
+/* Ring buffer of socket ids: head is only written by interrupts, tail only by the main loop */
+volatile uint8_t socket_event_buffer[SOCKET_EVENT_BUFFER_SIZE];
+volatile uint16_t socket_event_timestamps[SOCKET_EVENT_BUFFER_SIZE];
+volatile uint8_t socket_event_head;
+volatile uint8_t socket_event_tail;
+/* Set when a socket is queued, cleared when it is dequeued */
+volatile uint8_t socket_event_pending[NB_PROG_RIGS];
+/* Lines are only sampled once they are configured */
+volatile uint8_t socket_events_enabled = FALSE;
+
+
+/*! \fn     pushSocketEvent(uint8_t socket_id)
+*   \brief  Queue a socket event, to be called from interrupt context
+*   \param  socket_id   The socket ID
+*/
+static inline void pushSocketEvent(uint8_t socket_id)
+{
+    if (socket_event_pending[socket_id] == FALSE)
+    {
+        socket_event_pending[socket_id] = TRUE;
+        socket_event_buffer[socket_event_head] = socket_id;
+        socket_event_timestamps[socket_event_head] = (uint16_t)getTimestampMs();
+        socket_event_head = (socket_event_head + 1) & SOCKET_EVENT_BUFFER_MASK;
+        schedulerWakeTask(TASK_SOCKET_EVENTS);
+    }
+}
+
+/*! \fn     scanSocketInterruptLines(void)
+*   \brief  Queue an event for each socket having its interrupt line asserted
+*/
+static inline void scanSocketInterruptLines(void)
+{
+    uint8_t asserted_lines = 0;
+
+    for (uint8_t i = 0; i < NB_PROG_RIG_INT_LINES; i++)
+    {
+        if ((*int_pin_array[i] & int_pin_id_array[i]) == 0)
+        {
+            asserted_lines |= (1 << i);
+        }
+    }
+
+    if (asserted_lines != 0)
+    {
+        for (uint8_t i = 0; i < NB_EXPANDER_SOCKETS; i++)
+        {
+            if (asserted_lines & (1 << prog_rig_sockets[i].int_line))
+            {
+                pushSocketEvent(i);
+            }
+        }
+    }
+
+    /* Direct socket: button on PE6, 5v fault on PF6 */
+    if (((PINE & 0x40) == 0) || ((PINF & 0x40) == 0))
+    {
+        pushSocketEvent(DIRECT_SOCKET_ID);
+    }
+}
+
+/*! \fn     ISR(PCINT0_vect)
+*   \brief  Pin change on one of the PORTB interrupt lines
+*/
+ISR(PCINT0_vect)
+{
+    scanSocketInterruptLines();
+}
+
+/*! \fn     ISR(INT6_vect)
+*   \brief  Falling edge on the direct socket button
+*/
+ISR(INT6_vect)
+{
+    scanSocketInterruptLines();
+}
+
+/*! \fn     socketEventsTick(void)
+*   \brief  Function called by interrupt every ms, samples lines without pin change interrupts
+*/
+void socketEventsTick(void)
+{
+    if (socket_events_enabled != FALSE)
+    {
+        scanSocketInterruptLines();
+    }
+}
+
+/*! \fn     getNextSocketEvent(uint8_t* socket_id, uint16_t* timestamp)
+*   \brief  Dequeue the next socket event
+*   \param  socket_id   Where to store the socket ID
+*   \param  timestamp   Where to store the 16 LSBs of the ms timestamp at which the event was queued
+*   \return RETURN_OK if an event was dequeued, RETURN_NOK otherwise
+*/
+RET_TYPE getNextSocketEvent(uint8_t* socket_id, uint16_t* timestamp)
+{
+    uint8_t tail = socket_event_tail;
+
+    if (tail == socket_event_head)
+    {
+        return RETURN_NOK;
+    }
+
+    *socket_id = socket_event_buffer[tail];
+    *timestamp = socket_event_timestamps[tail];
+    socket_event_tail = (tail + 1) & SOCKET_EVENT_BUFFER_MASK;
+
+    /* From now on the socket can be queued again */
+    socket_event_pending[*socket_id] = FALSE;
+    return RETURN_OK;
+}
+
+/*! \fn     initSocketEvents(void)
+*   \brief  Initialize the interrupt lines and their interrupts
+*/
+void initSocketEvents(void)
+{
+    /* int signals: input with pull ups */
+    for (uint8_t i = 0; i < NB_PROG_RIG_INT_LINES; i++)
+    {
+        *int_ddr_array[i] &= ~(int_pin_id_array[i]);
+        *int_port_array[i] |= (int_pin_id_array[i]);
+    }
+
+    /* Pin change interrupts on PB2, PB3, PB5, PB6, PB7 */
+    PCMSK0 = (1 << PCINT2) | (1 << PCINT3) | (1 << PCINT5) | (1 << PCINT6) | (1 << PCINT7);
+    PCIFR = (1 << PCIF0);
+    PCICR |= (1 << PCIE0);
+
+    /* Falling edge interrupt on INT6 (PE6) */
+    EICRB = (EICRB & ~((1 << ISC61) | (1 << ISC60))) | (1 << ISC61);
+    EIFR = (1 << INTF6);
+    EIMSK |= (1 << INT6);
+    socket_events_enabled = TRUE;
+}
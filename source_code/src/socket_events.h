@@ -0,0 +1,42 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     socket_events.h
+*    \brief    Interrupt driven programming socket events
+*    Created:  17/10/2026
+*/
+
+
+#ifndef SOCKET_EVENTS_H_
+#define SOCKET_EVENTS_H_
+
+#include "prog_rig_sockets.h"
+#include "defines.h"
+#include <stdint.h>
+
+// Prototypes
+void initSocketEvents(void);
+void socketEventsTick(void);
+RET_TYPE getNextSocketEvent(uint8_t* socket_id, uint16_t* timestamp);
+
+// Defines
+#define SOCKET_EVENT_BUFFER_SIZE    32                      // Must be a power of 2, bigger than the number of sockets
+#define SOCKET_EVENT_BUFFER_MASK    (SOCKET_EVENT_BUFFER_SIZE-1)
+
+#endif /* SOCKET_EVENTS_H_ */
@@ -0,0 +1,131 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     socket_latency.c
+*    \brief    Programming socket latency histograms
+*    Created:  17/10/2026
+*
+*    Timestamps are the 16 LSBs of the 1ms tick timestamp, enough for the
+*    60s host timeout. Buckets are 8 bits saturating counters to fit in RAM,
+*    the host is expected to dump & reset them regularly. They take 51 bytes
+*    of RAM per socket, so they are only compiled in with ENABLE_SOCKET_LATENCY.
+*/
+#include "prog_rig_sockets.h"
+#include "socket_latency.h"
+#include "timer_manager.h"
+#include <string.h>
+#include "defines.h"
+#ifdef ENABLE_SOCKET_LATENCY
+
+/* Histograms for each socket */
+uint8_t socket_latency_histograms[NB_PROG_RIGS][NB_LATENCY_HISTOGRAMS][LATENCY_HISTOGRAM_BUCKETS];
+/* Timestamp of the last step reached by each socket, and that step */
+uint16_t socket_latency_last_timestamp[NB_PROG_RIGS];
+uint8_t socket_latency_stage[NB_PROG_RIGS];
+/* Stages of a programming cycle */
+enum latency_stage_t {STAGE_NONE = 0, STAGE_PRESSED, STAGE_POWERED, STAGE_READY};
+
+
+/*! \fn     recordLatency(uint8_t socket_id, uint8_t histogram, uint8_t from_stage, uint8_t to_stage)
+*   \brief  Add the time elapsed since the last step to a histogram, if the socket was at the expected step
+*   \param  socket_id   The socket ID
+*   \param  histogram   The histogram
+*   \param  from_stage  The expected last step
+*   \param  to_stage    The new step
+*/
+static void recordLatency(uint8_t socket_id, uint8_t histogram, uint8_t from_stage, uint8_t to_stage)
+{
+    uint16_t timestamp = (uint16_t)getTimestampMs();
+    uint16_t latency = timestamp - socket_latency_last_timestamp[socket_id];
+    uint8_t bucket = 0;
+
+    if (socket_latency_stage[socket_id] != from_stage)
+    {
+        socket_latency_stage[socket_id] = STAGE_NONE;
+        return;
+    }
+
+    /* Number of significant bits */
+    while ((latency != 0) && (bucket < LATENCY_HISTOGRAM_BUCKETS-1))
+    {
+        latency >>= 1;
+        bucket++;
+    }
+
+    if (socket_latency_histograms[socket_id][histogram][bucket] != 0xFF)
+    {
+        socket_latency_histograms[socket_id][histogram][bucket]++;
+    }
+    socket_latency_last_timestamp[socket_id] = timestamp;
+    socket_latency_stage[socket_id] = to_stage;
+}
+
+/*! \fn     socketLatencyButtonPressed(uint8_t socket_id, uint16_t timestamp)
+*   \brief  Signal a button press starting a programming cycle
+*   \param  socket_id   The socket ID
+*   \param  timestamp   16 LSBs of the ms timestamp at which the press was detected
+*/
+void socketLatencyButtonPressed(uint8_t socket_id, uint16_t timestamp)
+{
+    socket_latency_last_timestamp[socket_id] = timestamp;
+    socket_latency_stage[socket_id] = STAGE_PRESSED;
+}
+
+/*! \fn     socketLatency5vEnabled(uint8_t socket_id)
+*   \brief  Signal the 5v being enabled on a socket
+*   \param  socket_id   The socket ID
+*/
+void socketLatency5vEnabled(uint8_t socket_id)
+{
+    recordLatency(socket_id, LATENCY_BUTTON_TO_5V, STAGE_PRESSED, STAGE_POWERED);
+}
+
+/*! \fn     socketLatencyReady(uint8_t socket_id)
+*   \brief  Signal a socket being ready for programming
+*   \param  socket_id   The socket ID
+*/
+void socketLatencyReady(uint8_t socket_id)
+{
+    recordLatency(socket_id, LATENCY_5V_TO_READY, STAGE_POWERED, STAGE_READY);
+}
+
+/*! \fn     socketLatencyDone(uint8_t socket_id)
+*   \brief  Signal the host reporting a successful programming
+*   \param  socket_id   The socket ID
+*/
+void socketLatencyDone(uint8_t socket_id)
+{
+    recordLatency(socket_id, LATENCY_READY_TO_DONE, STAGE_READY, STAGE_NONE);
+}
+
+/*! \fn     getAndResetSocketLatencyHistograms(uint8_t socket_id, uint8_t* buffer, uint8_t reset)
+*   \brief  Get the histograms of a socket
+*   \param  socket_id   The socket ID
+*   \param  buffer      Where to store the LATENCY_HISTOGRAMS_SIZE bucket counters
+*   \param  reset       TRUE to clear the histograms
+*/
+void getAndResetSocketLatencyHistograms(uint8_t socket_id, uint8_t* buffer, uint8_t reset)
+{
+    memcpy(buffer, socket_latency_histograms[socket_id], LATENCY_HISTOGRAMS_SIZE);
+    if (reset != FALSE)
+    {
+        memset(socket_latency_histograms[socket_id], 0x00, LATENCY_HISTOGRAMS_SIZE);
+    }
+}
+#endif
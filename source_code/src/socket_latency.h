@@ -0,0 +1,54 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     socket_latency.h
+*    \brief    Programming socket latency histograms
+*    Created:  17/10/2026
+*/
+
+
+#ifndef SOCKET_LATENCY_H_
+#define SOCKET_LATENCY_H_
+
+#include "defines.h"
+#include <stdint.h>
+
+// Prototypes
+#ifdef ENABLE_SOCKET_LATENCY
+void getAndResetSocketLatencyHistograms(uint8_t socket_id, uint8_t* buffer, uint8_t reset);
+void socketLatencyButtonPressed(uint8_t socket_id, uint16_t timestamp);
+void socketLatency5vEnabled(uint8_t socket_id);
+void socketLatencyReady(uint8_t socket_id);
+void socketLatencyDone(uint8_t socket_id);
+#else
+    #define socketLatencyButtonPressed(socket_id, timestamp)    do {(void)(socket_id); (void)(timestamp);} while(0)
+    #define socketLatency5vEnabled(socket_id)                   do {(void)(socket_id);} while(0)
+    #define socketLatencyReady(socket_id)                       do {(void)(socket_id);} while(0)
+    #define socketLatencyDone(socket_id)                        do {(void)(socket_id);} while(0)
+#endif
+
+// Defines
+#define LATENCY_BUTTON_TO_5V        0       // Button press to 5v enable
+#define LATENCY_5V_TO_READY         1       // 5v enable to ready signaled
+#define LATENCY_READY_TO_DONE       2       // Ready signaled to CMD_PROG_DONE
+#define NB_LATENCY_HISTOGRAMS       3
+#define LATENCY_HISTOGRAM_BUCKETS   16      // Bucket 0: 0ms, bucket n: [2^(n-1), 2^n[ ms, last bucket open ended
+#define LATENCY_HISTOGRAMS_SIZE     (NB_LATENCY_HISTOGRAMS*LATENCY_HISTOGRAM_BUCKETS)
+
+#endif /* SOCKET_LATENCY_H_ */
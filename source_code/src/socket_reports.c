@@ -0,0 +1,153 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     socket_reports.c
+*    \brief    Programming socket reports to the host
+*    Created:  17/10/2026
+*
+*    Socket events are stored in a FIFO with a sequence number and kept
+*    until the host acknowledges them with CMD_ACK_SOCKET_REPORTS. Once
+*    enabled by CMD_SET_SOCKET_REPORTS, unacknowledged events are pushed on
+*    the raw HID IN endpoint as CMD_SOCKET_REPORT packets of up to
+*    SOCKET_REPORTS_PER_PACKET events, interleaved with the command answers.
+*    Enabling the reports again replays every unacknowledged event, so a
+*    reconnecting host resumes from its last acknowledged sequence number.
+*    Nothing is queued while the reports are disabled, so a legacy host
+*    never fills the FIFO with events nobody will read. Events occurring
+*    while the FIFO is full still consume a sequence number: the host sees
+*    the gap and can fall back to CMD_BUTTON_PRESSED.
+*    Packets are only sent when the endpoint bank is free, so a host that
+*    stops reading never stalls the main loop.
+*/
+#include "usb_cmd_parser.h"
+#include "socket_reports.h"
+#include "timer_manager.h"
+#include "defines.h"
+#include "usb.h"
+
+/* Events FIFO: from tail to send index waiting for an ack, from send index to head waiting to be sent */
+socketReport_t socket_report_buffer[SOCKET_REPORT_BUFFER_SIZE];
+uint8_t socket_report_head;
+uint8_t socket_report_send_idx;
+uint8_t socket_report_tail;
+/* Sequence number of the next event */
+uint16_t socket_report_next_seq = 1;
+/* Set when the host asked for reports */
+uint8_t socket_reports_enabled = FALSE;
+
+
+/*! \fn     enableSocketReports(uint8_t enable)
+*   \brief  Enable or disable the reports, unacknowledged events are sent again when enabling
+*   \param  enable  TRUE to enable
+*/
+void enableSocketReports(uint8_t enable)
+{
+    socket_report_send_idx = socket_report_tail;
+    socket_reports_enabled = enable;
+}
+
+/*! \fn     areSocketReportsEnabled(void)
+*   \brief  Know if the host asked for reports
+*   \return TRUE or FALSE
+*/
+uint8_t areSocketReportsEnabled(void)
+{
+    return (socket_reports_enabled != FALSE) ? TRUE : FALSE;
+}
+
+/*! \fn     acknowledgeSocketReports(uint16_t seq)
+*   \brief  Free the events the host received
+*   \param  seq     Sequence number of the last event received by the host
+*/
+void acknowledgeSocketReports(uint16_t seq)
+{
+    while ((socket_report_tail != socket_report_head) && ((int16_t)(socket_report_buffer[socket_report_tail].seq - seq) <= 0))
+    {
+        if (socket_report_send_idx == socket_report_tail)
+        {
+            socket_report_send_idx = (socket_report_send_idx + 1) & SOCKET_REPORT_BUFFER_MASK;
+        }
+        socket_report_tail = (socket_report_tail + 1) & SOCKET_REPORT_BUFFER_MASK;
+    }
+}
+
+/*! \fn     queueSocketReport(uint8_t socket_id, uint8_t event_type)
+*   \brief  Queue an event for the host, if it asked for reports
+*   \param  socket_id   The socket ID
+*   \param  event_type  The event type
+*/
+void queueSocketReport(uint8_t socket_id, uint8_t event_type)
+{
+    uint8_t next_head = (socket_report_head + 1) & SOCKET_REPORT_BUFFER_MASK;
+    uint16_t seq;
+
+    if (socket_reports_enabled == FALSE)
+    {
+        return;
+    }
+
+    seq = socket_report_next_seq++;
+    if (next_head == socket_report_tail)
+    {
+        return;
+    }
+
+    socket_report_buffer[socket_report_head].seq = seq;
+    socket_report_buffer[socket_report_head].socket_id = socket_id;
+    socket_report_buffer[socket_report_head].event_type = event_type;
+    socket_report_buffer[socket_report_head].timestamp = getTimestampMs();
+    socket_report_head = next_head;
+}
+
+/*! \fn     areSocketReportsPending(void)
+*   \brief  Know if events are waiting to be sent to the host
+*   \return TRUE or FALSE
+*/
+uint8_t areSocketReportsPending(void)
+{
+    if ((socket_reports_enabled != FALSE) && (socket_report_send_idx != socket_report_head))
+    {
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/*! \fn     sendSocketReports(void)
+*   \brief  Send the queued events the IN endpoint can take without waiting
+*/
+void sendSocketReports(void)
+{
+    socketReport_t packet_reports[SOCKET_REPORTS_PER_PACKET];
+    uint8_t nb_reports;
+
+    if (socket_reports_enabled == FALSE)
+    {
+        return;
+    }
+
+    while ((socket_report_send_idx != socket_report_head) && (isUsbHidTxReady() == TRUE))
+    {
+        for (nb_reports = 0; (nb_reports < SOCKET_REPORTS_PER_PACKET) && (socket_report_send_idx != socket_report_head); nb_reports++)
+        {
+            packet_reports[nb_reports] = socket_report_buffer[socket_report_send_idx];
+            socket_report_send_idx = (socket_report_send_idx + 1) & SOCKET_REPORT_BUFFER_MASK;
+        }
+        usbSendMessage(CMD_SOCKET_REPORT, nb_reports * sizeof(socketReport_t), packet_reports);
+    }
+}
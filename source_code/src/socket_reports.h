@@ -0,0 +1,57 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     socket_reports.h
+*    \brief    Programming socket reports to the host
+*    Created:  17/10/2026
+*/
+
+
+#ifndef SOCKET_REPORTS_H_
+#define SOCKET_REPORTS_H_
+
+#include "defines.h"
+#include <stdint.h>
+
+// Structs
+typedef struct
+{
+    uint16_t seq;               // Incremented for each event, little endian
+    uint8_t socket_id;
+    uint8_t event_type;
+    uint32_t timestamp;         // ms since boot, little endian
+} socketReport_t;
+
+// Prototypes
+void queueSocketReport(uint8_t socket_id, uint8_t event_type);
+void acknowledgeSocketReports(uint16_t seq);
+void enableSocketReports(uint8_t enable);
+void sendSocketReports(void);
+uint8_t areSocketReportsPending(void);
+uint8_t areSocketReportsEnabled(void);
+
+// Defines
+#define SOCKET_REPORT_READY         0x01    // 5v settled, the host can program the socket
+#define SOCKET_REPORT_SHORTED       0x02    // 5v fault, power cut
+#define SOCKET_REPORT_TIMEOUT       0x03    // The host didn't report the programming result in time
+#define SOCKET_REPORT_BUFFER_SIZE   32      // Must be a power of 2
+#define SOCKET_REPORT_BUFFER_MASK   (SOCKET_REPORT_BUFFER_SIZE-1)
+#define SOCKET_REPORTS_PER_PACKET   (PACKET_EXPORT_SIZE / sizeof(socketReport_t))
+
+#endif /* SOCKET_REPORTS_H_ */
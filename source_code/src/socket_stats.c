@@ -0,0 +1,85 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     socket_stats.c
+*    \brief    Programming socket statistics
+*    Created:  17/10/2026
+*/
+#include "prog_rig_sockets.h"
+#include "timer_manager.h"
+#include "socket_stats.h"
+#include <string.h>
+#include "defines.h"
+
+/* Counters for each socket */
+socketStats_t socket_stats[NB_PROG_RIGS];
+/* Timestamp of the button press for the sockets in a programming cycle */
+uint32_t socket_stats_cycle_start[NB_PROG_RIGS];
+uint8_t socket_stats_in_cycle[NB_PROG_RIGS];
+
+
+/*! \fn     socketStatsCycleStarted(uint8_t socket_id)
+*   \brief  Signal the start of a programming cycle
+*   \param  socket_id   The socket ID
+*/
+void socketStatsCycleStarted(uint8_t socket_id)
+{
+    socket_stats[socket_id].nb_cycles++;
+    socket_stats_cycle_start[socket_id] = getTimestampMs();
+    socket_stats_in_cycle[socket_id] = TRUE;
+}
+
+/*! \fn     socketStatsCycleEnded(uint8_t socket_id, uint8_t outcome)
+*   \brief  Signal the end of a programming cycle
+*   \param  socket_id   The socket ID
+*   \param  outcome     SOCKET_STATS_PASSED, SOCKET_STATS_FAILED or SOCKET_STATS_SHORTED
+*/
+void socketStatsCycleEnded(uint8_t socket_id, uint8_t outcome)
+{
+    /* The host may report a result for a socket that isn't programming */
+    if (socket_stats_in_cycle[socket_id] == FALSE)
+    {
+        return;
+    }
+    socket_stats_in_cycle[socket_id] = FALSE;
+    socket_stats[socket_id].busy_time_ms += getTimestampMs() - socket_stats_cycle_start[socket_id];
+
+    if (outcome == SOCKET_STATS_PASSED)
+    {
+        socket_stats[socket_id].nb_passed++;
+    }
+    else if (outcome == SOCKET_STATS_SHORTED)
+    {
+        socket_stats[socket_id].nb_shorted++;
+    }
+    else
+    {
+        socket_stats[socket_id].nb_failed++;
+    }
+}
+
+/*! \fn     getSocketStats(uint8_t socket_id, socketStats_t* stats)
+*   \brief  Get the statistics of a socket, cycle in progress not included
+*   \param  socket_id   The socket ID
+*   \param  stats       Where to store the statistics
+*/
+void getSocketStats(uint8_t socket_id, socketStats_t* stats)
+{
+    memcpy(stats, &socket_stats[socket_id], sizeof(socketStats_t));
+}
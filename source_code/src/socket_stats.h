@@ -0,0 +1,53 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     socket_stats.h
+*    \brief    Programming socket statistics
+*    Created:  17/10/2026
+*/
+
+
+#ifndef SOCKET_STATS_H_
+#define SOCKET_STATS_H_
+
+#include "defines.h"
+#include <stdint.h>
+
+// Structs
+typedef struct
+{
+    uint16_t nb_cycles;         // Number of button presses starting a programming cycle
+    uint16_t nb_passed;
+    uint16_t nb_failed;         // Failures reported by the host & host timeouts
+    uint16_t nb_shorted;
+    uint32_t busy_time_ms;      // Cumulative time spent between button press and cycle end
+} socketStats_t;
+
+// Prototypes
+void getSocketStats(uint8_t socket_id, socketStats_t* stats);
+void socketStatsCycleEnded(uint8_t socket_id, uint8_t outcome);
+void socketStatsCycleStarted(uint8_t socket_id);
+
+// Defines
+#define SOCKET_STATS_PASSED         0x00
+#define SOCKET_STATS_FAILED         0x01
+#define SOCKET_STATS_SHORTED        0x02
+#define SOCKET_STATS_PER_PACKET     (PACKET_EXPORT_SIZE / sizeof(socketStats_t))
+
+#endif /* SOCKET_STATS_H_ */
@@ -0,0 +1,225 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     soft_i2c.c
+*    \brief    Bit banged I2C bus
+*    Created:  17/10/2026
+*
+*    Blocking single register accesses, only used when the bench has more
+*    extenders than the TWI bus can address.
+*/
+#include "prog_rig_sockets.h"
+#ifdef PROG_RIG_SOFT_I2C_BUS
+#include <util/delay.h>
+#include <avr/io.h>
+#include "soft_i2c.h"
+#include "defines.h"
+#include "i2c.h"
+
+
+/*! \fn     softI2cSclHigh(void)
+*   \brief  Release SCL and wait for slaves stretching the clock
+*   \return RETURN_OK or RETURN_NOK if SCL is held low for too long
+*/
+static RET_TYPE softI2cSclHigh(void)
+{
+    soft_scl_release();
+    for (uint8_t i = 0; i < SOFT_I2C_STRETCH_TIMEOUT; i++)
+    {
+        if (PIN_SOFT_I2C_SCL & (1 << PORTID_SOFT_I2C_SCL))
+        {
+            _delay_us(SOFT_I2C_HALF_PERIOD_US);
+            return RETURN_OK;
+        }
+        _delay_us(SOFT_I2C_HALF_PERIOD_US);
+    }
+    return RETURN_NOK;
+}
+
+/*! \fn     softI2cStart(void)
+*   \brief  Generate a (repeated) start condition
+*/
+static void softI2cStart(void)
+{
+    soft_sda_release();
+    softI2cSclHigh();
+    soft_sda_low();
+    _delay_us(SOFT_I2C_HALF_PERIOD_US);
+    soft_scl_low();
+}
+
+/*! \fn     softI2cStop(void)
+*   \brief  Generate a stop condition
+*/
+static void softI2cStop(void)
+{
+    soft_sda_low();
+    _delay_us(SOFT_I2C_HALF_PERIOD_US);
+    softI2cSclHigh();
+    soft_sda_release();
+    _delay_us(SOFT_I2C_HALF_PERIOD_US);
+}
+
+/*! \fn     softI2cWriteByte(uint8_t data)
+*   \brief  Clock a byte out and read the acknowledge bit
+*   \param  data    The byte
+*   \return RETURN_OK if the slave acknowledged it
+*/
+static RET_TYPE softI2cWriteByte(uint8_t data)
+{
+    RET_TYPE ret_val = RETURN_OK;
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        if (data & 0x80)
+        {
+            soft_sda_release();
+        }
+        else
+        {
+            soft_sda_low();
+        }
+        _delay_us(SOFT_I2C_HALF_PERIOD_US);
+        softI2cSclHigh();
+        soft_scl_low();
+        data <<= 1;
+    }
+
+    // Acknowledge bit
+    soft_sda_release();
+    _delay_us(SOFT_I2C_HALF_PERIOD_US);
+    if (softI2cSclHigh() != RETURN_OK)
+    {
+        ret_val = RETURN_NOK;
+    }
+    if (PIN_SOFT_I2C_SDA & (1 << PORTID_SOFT_I2C_SDA))
+    {
+        ret_val = RETURN_NOK;
+    }
+    soft_scl_low();
+    return ret_val;
+}
+
+/*! \fn     softI2cReadByte(void)
+*   \brief  Clock a byte in, not acknowledged as we only read single bytes
+*   \return The byte
+*/
+static uint8_t softI2cReadByte(void)
+{
+    uint8_t data = 0;
+
+    soft_sda_release();
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        _delay_us(SOFT_I2C_HALF_PERIOD_US);
+        softI2cSclHigh();
+        data <<= 1;
+        if (PIN_SOFT_I2C_SDA & (1 << PORTID_SOFT_I2C_SDA))
+        {
+            data |= 0x01;
+        }
+        soft_scl_low();
+    }
+
+    // Not acknowledge
+    _delay_us(SOFT_I2C_HALF_PERIOD_US);
+    softI2cSclHigh();
+    soft_scl_low();
+    return data;
+}
+
+/*! \fn     softI2cWrite(uint8_t addr, uint8_t reg, uint8_t data)
+*   \brief  Write a register on the bit banged bus
+*   \param  addr    The chip address
+*   \param  reg     The register
+*   \param  data    The data to write
+*   \return Operation success
+*/
+RET_TYPE softI2cWrite(uint8_t addr, uint8_t reg, uint8_t data)
+{
+    RET_TYPE ret_val = RETURN_OK;
+
+    softI2cStart();
+    if (softI2cWriteByte(addr & 0xFE) != RETURN_OK)
+    {
+        ret_val = I2C_SLA_ERROR;
+    }
+    else if ((softI2cWriteByte(reg) != RETURN_OK) || (softI2cWriteByte(data) != RETURN_OK))
+    {
+        ret_val = I2C_DATA_ERROR;
+    }
+    softI2cStop();
+    return ret_val;
+}
+
+/*! \fn     softI2cRead(uint8_t addr, uint8_t reg, uint8_t* data)
+*   \brief  Read a register on the bit banged bus
+*   \param  addr    The chip address
+*   \param  reg     The register
+*   \param  data    Where to store the read data
+*   \return Operation success
+*/
+RET_TYPE softI2cRead(uint8_t addr, uint8_t reg, uint8_t* data)
+{
+    RET_TYPE ret_val = RETURN_OK;
+
+    softI2cStart();
+    if (softI2cWriteByte(addr & 0xFE) != RETURN_OK)
+    {
+        ret_val = I2C_SLA_ERROR;
+    }
+    else if (softI2cWriteByte(reg) != RETURN_OK)
+    {
+        ret_val = I2C_DATA_ERROR;
+    }
+    else
+    {
+        softI2cStart();
+        if (softI2cWriteByte(addr | 0x01) != RETURN_OK)
+        {
+            ret_val = I2C_SLAR_ERROR;
+        }
+        else
+        {
+            *data = softI2cReadByte();
+        }
+    }
+    softI2cStop();
+    return ret_val;
+}
+
+/*! \fn     initSoftI2cPort(void)
+*   \brief  Initialize the bit banged bus IOs
+*/
+void initSoftI2cPort(void)
+{
+    // Lines released, external pull ups helped by the internal ones
+    soft_scl_release();
+    soft_sda_release();
+
+    // A slave may be stuck in a transfer after a quick reboot
+    for (uint8_t i = 0; (i < 9) && ((PIN_SOFT_I2C_SDA & (1 << PORTID_SOFT_I2C_SDA)) == 0); i++)
+    {
+        soft_scl_low();
+        _delay_us(SOFT_I2C_HALF_PERIOD_US);
+        softI2cSclHigh();
+    }
+    softI2cStop();
+}
+#endif
@@ -0,0 +1,62 @@
+/* CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at src/license_cddl-1.0.txt
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at src/license_cddl-1.0.txt
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ */
+/*!  \file     soft_i2c.h
+*    \brief    Bit banged I2C bus
+*    Created:  17/10/2026
+*/
+
+
+#ifndef SOFT_I2C_H_
+#define SOFT_I2C_H_
+
+#include "defines.h"
+
+// Prototypes
+RET_TYPE softI2cRead(uint8_t addr, uint8_t reg, uint8_t* data);
+RET_TYPE softI2cWrite(uint8_t addr, uint8_t reg, uint8_t data);
+void initSoftI2cPort(void);
+
+// Defines
+#define SOFT_I2C_HALF_PERIOD_US     4       // ~100kHz once the IO overhead is added
+#define SOFT_I2C_STRETCH_TIMEOUT    250     // Max number of half periods a slave may hold SCL low
+
+// Macros: lines are driven open drain, a released line gets the internal pull up
+// The output latch is always cleared before the line is made an output, so it is never driven high
+/*! \fn     soft_scl_release()
+*   \brief  Release SCL
+*/
+#define soft_scl_release()  do {DDR_SOFT_I2C_SCL &= ~(1 << PORTID_SOFT_I2C_SCL); PORT_SOFT_I2C_SCL |= (1 << PORTID_SOFT_I2C_SCL);} while(0)
+
+/*! \fn     soft_scl_low()
+*   \brief  Pull SCL low
+*/
+#define soft_scl_low()      do {PORT_SOFT_I2C_SCL &= ~(1 << PORTID_SOFT_I2C_SCL); DDR_SOFT_I2C_SCL |= (1 << PORTID_SOFT_I2C_SCL);} while(0)
+
+/*! \fn     soft_sda_release()
+*   \brief  Release SDA
+*/
+#define soft_sda_release()  do {DDR_SOFT_I2C_SDA &= ~(1 << PORTID_SOFT_I2C_SDA); PORT_SOFT_I2C_SDA |= (1 << PORTID_SOFT_I2C_SDA);} while(0)
+
+/*! \fn     soft_sda_low()
+*   \brief  Pull SDA low
+*/
+#define soft_sda_low()      do {PORT_SOFT_I2C_SDA &= ~(1 << PORTID_SOFT_I2C_SDA); DDR_SOFT_I2C_SDA |= (1 << PORTID_SOFT_I2C_SDA);} while(0)
+
+#endif /* SOFT_I2C_H_ */
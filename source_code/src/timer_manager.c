@@ -26,35 +26,116 @@
 #include <util/atomic.h>
 #include "defines.h"
 
-// Timers array
+// Timers array, active timers are chained in a list sorted by expiry date
 volatile timerEntry_t context_timers[TOTAL_NUMBER_OF_TIMERS];
-volatile uint16_t timer_divider;
+volatile uint8_t timer_list_head = TIMER_LIST_END;
+// Number of ms since boot
+volatile uint32_t timer_timestamp_ms;
+// Callbacks to call from the main loop when a timer expires
+timerCallback_t timer_callbacks[TOTAL_NUMBER_OF_TIMERS];
+// Expired timers having a callback: head only written by the tick, tail only by the main loop
+volatile uint8_t timer_expired_buffer[TIMER_EXPIRED_BUFFER_SIZE];
+volatile uint8_t timer_expired_head;
+volatile uint8_t timer_expired_tail;
 
 
 /*!	\fn		timerManagerTick(void)
 *	\brief	Function called by interrupt every ms
+*   \note   Only the first timer of the list is decremented, the others are relative to it
 */
 void timerManagerTick(void)
 {
-    uint8_t i;
+    uint8_t uid = timer_list_head;
     
-    // Increment divider
-    timer_divider++;
+    // Increment timestamp
+    timer_timestamp_ms++;
     
-    // Loop through the timers
-    for (i = 0; i < TOTAL_NUMBER_OF_TIMERS; i++)
+    if (uid == TIMER_LIST_END)
     {
-        // If it's a fast timer or if it not & timer_divider rolled over
-        if ((i < NUMBER_OF_FAST_TIMERS) || (timer_divider == 0))
+        return;
+    }
+    
+    // Remove the first timer and all the ones expiring at the same time
+    if (--context_timers[uid].delta == 0)
+    {
+        do
         {
-            if (context_timers[i].timer_val != 0)
+            context_timers[uid].flag = TIMER_EXPIRED;
+            context_timers[uid].active = FALSE;
+            if ((timer_callbacks[uid] != 0) && (((timer_expired_head + 1) & TIMER_EXPIRED_BUFFER_MASK) != timer_expired_tail))
             {
-                if (context_timers[i].timer_val-- == 1)
-                {
-                    context_timers[i].flag = TIMER_EXPIRED;
-                }
+                timer_expired_buffer[timer_expired_head] = uid;
+                timer_expired_head = (timer_expired_head + 1) & TIMER_EXPIRED_BUFFER_MASK;
             }
+            uid = context_timers[uid].next;
+        }
+        while ((uid != TIMER_LIST_END) && (context_timers[uid].delta == 0));
+        timer_list_head = uid;
+    }
+}
+
+/*!	\fn		removeTimerFromList(uint8_t uid)
+*	\brief	Remove an active timer from the list, to be called with interrupts disabled
+*   \param  uid     Unique ID
+*/
+static void removeTimerFromList(uint8_t uid)
+{
+    uint8_t next = context_timers[uid].next;
+    
+    // The next timer now expires relative to our predecessor
+    if (next != TIMER_LIST_END)
+    {
+        context_timers[next].delta += context_timers[uid].delta;
+    }
+    
+    if (timer_list_head == uid)
+    {
+        timer_list_head = next;
+    }
+    else
+    {
+        uint8_t prev = timer_list_head;
+        while (context_timers[prev].next != uid)
+        {
+            prev = context_timers[prev].next;
         }
+        context_timers[prev].next = next;
+    }
+    context_timers[uid].active = FALSE;
+}
+
+/*!	\fn		insertTimerInList(uint8_t uid, uint32_t delay)
+*	\brief	Insert a timer in the list, to be called with interrupts disabled
+*   \param  uid     Unique ID
+*   \param  delay   Delay in ms, not null
+*/
+static void insertTimerInList(uint8_t uid, uint32_t delay)
+{
+    uint8_t prev = TIMER_LIST_END;
+    uint8_t cur = timer_list_head;
+    
+    // Timers expiring at the same date are kept in activation order
+    while ((cur != TIMER_LIST_END) && (context_timers[cur].delta <= delay))
+    {
+        delay -= context_timers[cur].delta;
+        prev = cur;
+        cur = context_timers[cur].next;
+    }
+    
+    context_timers[uid].delta = delay;
+    context_timers[uid].next = cur;
+    context_timers[uid].active = TRUE;
+    if (cur != TIMER_LIST_END)
+    {
+        context_timers[cur].delta -= delay;
+    }
+    if (prev == TIMER_LIST_END)
+    {
+        timer_list_head = uid;
+    }
+    else
+    {
+        context_timers[prev].next = uid;
     }
 }
 
@@ -84,37 +165,119 @@ RET_TYPE hasTimerExpired(uint8_t uid, uint8_t clear)
 /*!	\fn		activateTimer(uint8_t uid, uint16_t val)
 *	\brief	Activate timer
 *   \param  uid Unique ID
-*   \param  val Delay
+*   \param  val Delay, in ms for fast timers or in 65536ms units for slow timers
 */
 void activateTimer(uint8_t uid, uint16_t val)
 {
-    // Compare is done in one cycle
-    if (context_timers[uid].timer_val != val)
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
     {
-        ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+        // Stopping a stopped timer doesn't change its flag
+        if ((val != 0) || (context_timers[uid].active != FALSE))
         {
-            context_timers[uid].timer_val = val;
+            if (context_timers[uid].active != FALSE)
+            {
+                removeTimerFromList(uid);
+            }
             if (val == 0)
             {
                 context_timers[uid].flag = TIMER_EXPIRED;
             } 
             else
             {
+                if (uid < NUMBER_OF_FAST_TIMERS)
+                {
+                    insertTimerInList(uid, val);
+                }
+                else
+                {
+                    insertTimerInList(uid, (uint32_t)val << 16);
+                }
                 context_timers[uid].flag = TIMER_RUNNING;
             }
         }
     }
 }
 
+/*!	\fn		setTimerCallback(uint8_t uid, timerCallback_t callback)
+*	\brief	Set a function to be called by timerManagerRunCallbacks() once the timer expires
+*   \param  uid         Unique ID
+*   \param  callback    The callback, 0 for none
+*/
+void setTimerCallback(uint8_t uid, timerCallback_t callback)
+{
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        timer_callbacks[uid] = callback;
+    }
+}
+
+/*!	\fn		timerManagerRunCallbacks(void)
+*	\brief	Call the callbacks of the timers that expired, to be called from the main loop
+*/
+void timerManagerRunCallbacks(void)
+{
+    while (timer_expired_tail != timer_expired_head)
+    {
+        uint8_t uid = timer_expired_buffer[timer_expired_tail];
+        timer_expired_tail = (timer_expired_tail + 1) & TIMER_EXPIRED_BUFFER_MASK;
+        
+        // The callback may have been removed in the meantime
+        if (timer_callbacks[uid] != 0)
+        {
+            timer_callbacks[uid]();
+        }
+    }
+}
 
 /*!	\fn		getTimerVal(uint8_t uid)
 *	\brief	Get current timer val
 *   \param  uid     Unique ID
-*   \return the timer val
+*   \return the timer val, in ms for fast timers or in 65536ms units for slow timers
 */
 uint16_t getTimerVal(uint8_t uid)
 {
-    return context_timers[uid].timer_val;
+    uint32_t remaining = 0;
+    
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        if (context_timers[uid].active != FALSE)
+        {
+            uint8_t cur = timer_list_head;
+            while (1)
+            {
+                remaining += context_timers[cur].delta;
+                if (cur == uid)
+                {
+                    break;
+                }
+                cur = context_timers[cur].next;
+            }
+        }
+    }
+    
+    if (uid < NUMBER_OF_FAST_TIMERS)
+    {
+        return (uint16_t)remaining;
+    }
+    else
+    {
+        return (uint16_t)((remaining + 0xFFFF) >> 16);
+    }
+}
+
+/*!	\fn		getTimestampMs(void)
+*	\brief	Get the number of ms since boot
+*   \return the timestamp
+*/
+uint32_t getTimestampMs(void)
+{
+    uint32_t timestamp;
+
+    ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+    {
+        timestamp = timer_timestamp_ms;
+    }
+    return timestamp;
 }
 
 /*!	\fn		timerBasedDelayMs(uint16_t ms)
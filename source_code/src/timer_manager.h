@@ -27,14 +27,21 @@
 #ifndef TIMER_MANAGER_H_
 #define TIMER_MANAGER_H_
 
+#include "prog_rig_sockets.h"
 #include "defines.h"
 #include <stdint.h>
 
+// Typedefs
+typedef void (*timerCallback_t)(void);
+
 // Prototypes
+void setTimerCallback(uint8_t uid, timerCallback_t callback);
+void timerManagerRunCallbacks(void);
 void timerManagerTick(void);
 void timerBased130MsDelay(void);
 void timerBased500MsDelay(void);
 uint16_t getTimerVal(uint8_t uid);
+uint32_t getTimestampMs(void);
 void timerBasedDelayMs(uint16_t ms);
 void activateTimer(uint8_t uid, uint16_t val);
 RET_TYPE hasTimerExpired(uint8_t uid, uint8_t clear);
@@ -42,13 +49,15 @@ RET_TYPE hasTimerExpired(uint8_t uid, uint8_t clear);
 // Structs
 typedef struct
 {
-    uint16_t timer_val;
+    uint32_t delta;             // ms between the expiry of the previous timer in the list and this one
+    uint8_t next;               // Next timer in the list, TIMER_LIST_END for the last one
+    uint8_t active;             // Set while in the list
     uint8_t flag;
 } timerEntry_t;
 
 // Defines
 #ifdef MINI_VERSION
-    #define NUMBER_OF_FAST_TIMERS   18
+    #define NUMBER_OF_FAST_TIMERS   (TIMER_PROG_RIG_0+NB_PROG_RIGS)
     #define TIMER_SCREEN            0
     #define TIMER_USERINT           1
     #define TIMER_CAPS              2
@@ -58,10 +67,11 @@ typedef struct
     #define TIMER_USB_SUSPEND       6
     #define TIMER_REBOOT            7
     #define TIMER_FLASHING          8
-    #define TIMER_PROG_RIG_0        9
+    #define TIMER_PROG_RIG_RETRY    9       // Failed extender output writes retry period
+    #define TIMER_PROG_RIG_0        10      // One timer per programming socket
 
     #define NUMBER_OF_SLOW_TIMERS   1
-    #define SLOW_TIMER_LOCKOUT      18
+    #define SLOW_TIMER_LOCKOUT      NUMBER_OF_FAST_TIMERS
 #else
     #define NUMBER_OF_FAST_TIMERS   10
     #define TIMER_LIGHT             0
@@ -80,5 +90,8 @@ typedef struct
 #endif
 
 #define TOTAL_NUMBER_OF_TIMERS  (NUMBER_OF_FAST_TIMERS+NUMBER_OF_SLOW_TIMERS)
+#define TIMER_LIST_END          0xFF
+#define TIMER_EXPIRED_BUFFER_SIZE   64      // Must be a power of 2, bigger than the number of timers
+#define TIMER_EXPIRED_BUFFER_MASK   (TIMER_EXPIRED_BUFFER_SIZE-1)
 
 #endif /* TIMER_MANAGER_H_ */
\ No newline at end of file